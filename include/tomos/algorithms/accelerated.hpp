@@ -0,0 +1,190 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../projections.hpp"
+#include "../projector.hpp"
+#include "../util/matrix_sums.hpp"
+#include "stopping_criterion.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+namespace detail {
+
+/**
+ * FISTA on \f$\frac{1}{2} \| \vec{p} - W \vec{x} \|_R^2\f$, with gradient
+ * steps scaled by \f$\beta C\f$. Without preconditioning, \f$R = I\f$ and
+ * \f$C = I\f$.
+ */
+template <dimension D, typename T>
+image<D, T> fista_(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                   tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
+                   double beta, int iterations,
+                   std::function<void(image<D, T>&, int)> callback,
+                   bool box_constraint, T box_min, T box_max,
+                   bool precondition, stopping_criterion* stop) {
+    image<D, T> x(v);
+    image<D, T> y(v);
+
+    // without preconditioning R and C are constant, and are not stored
+    std::optional<matrix_sums<D, T>> sums;
+    if (precondition) {
+        sums.emplace(tomo::row_and_column_sums<D, T>(g, kernel));
+        for (auto& r : sums->rows) {
+            r = (math::abs(r) > math::epsilon<T>) ? ((T)1.0 / r) : (T)0.0;
+        }
+
+        for (auto& bc : sums->columns) {
+            bc = (math::abs(bc) > math::epsilon<T>) ? ((T)beta / bc) : (T)0.0;
+        }
+    }
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
+    projections<D, T> s1(g);
+    image<D, T> s2(v);
+    T t = (T)1;
+    for (int k = 0; k < iterations; ++k) {
+        // compute Wy
+        for (auto[idx, line] : g) {
+            for (auto elem : kernel(line)) {
+                s1[idx] += y[elem.index] * elem.value;
+            }
+        }
+
+        // compute R(p - Wy)
+        auto residual = (T)0;
+        for (uint64_t j = 0; j < g.lines(); ++j) {
+            auto d = p[j] - s1[j];
+            residual += d * d;
+            s1[j] = precondition ? d * sums->rows[j] : d;
+        }
+
+        // multiply with W^T
+        for (auto[idx, line] : g) {
+            for (auto elem : kernel(line)) {
+                s2[elem.index] += elem.value * s1[idx];
+            }
+        }
+
+        // gradient step from y, scaled with beta * C
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto bc = precondition ? sums->columns[j] : (T)beta;
+            s2[j] = y[j] + bc * s2[j];
+        }
+
+        if (box_constraint) {
+            math::box(s2, box_min, box_max);
+        }
+
+        // momentum step, y = x_k + (t_k - 1) / t_{k + 1} (x_k - x_{k - 1})
+        auto t_next = (T)0.5 * ((T)1 + math::sqrt((T)1 + (T)4 * t * t));
+        auto momentum = (t - (T)1) / t_next;
+        auto update = (T)0;
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto delta = s2[j] - x[j];
+            update += delta * delta;
+            y[j] = s2[j] + momentum * delta;
+            x[j] = s2[j];
+        }
+        t = t_next;
+
+        s1.clear();
+        s2.clear();
+
+        if (callback) {
+            callback(x, k);
+        }
+
+        if (stop) {
+            // the residual is that of the extrapolated point y
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(x);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return x;
+}
+
+} // namespace detail
+
+/**
+ * Landweber iteration accelerated with Nesterov momentum (FISTA). For
+ * convergence, `beta` should not exceed \f$1 / \|W\|^2\f$.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ *
+ * \param v the volume of the imaged object
+ * \param g the geometry of the problem
+ * \param p the measurements (projections)
+ * \param beta (optional) the step size
+ * \param iterations (optional) the number of iterations to perform
+ * \param box_constraint (optional) whether to clamp the image to
+ * [box_min, box_max] after each step
+ * \param stop (optional) a criterion for stopping early
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T>
+accelerated_landweber(const volume<D, T>& v,
+                      const tomo::geometry::base<D, T>& g,
+                      tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
+                      double beta = 1.0, int iterations = 10,
+                      std::function<void(image<D, T>&, int)> callback = {},
+                      bool box_constraint = false, T box_min = -1,
+                      T box_max = 1, stopping_criterion* stop = nullptr) {
+    return detail::fista_(v, g, kernel, p, beta, iterations, callback,
+                          box_constraint, box_min, box_max, false, stop);
+}
+
+/**
+ * SIRT accelerated with Nesterov momentum (FISTA). This uses the SIRT
+ * update, see `sirt`, as the gradient step, and extrapolates the next
+ * iterate using the previous one. Compared to SIRT, it requires one
+ * additional image.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ *
+ * \param v the volume of the imaged object
+ * \param g the geometry of the problem
+ * \param p the measurements (projections)
+ * \param beta (optional) a relaxation parameter, at most 1
+ * \param iterations (optional) the number of iterations to perform
+ * \param box_constraint (optional) whether to clamp the image to
+ * [box_min, box_max] after each step
+ * \param stop (optional) a criterion for stopping early
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T>
+accelerated_sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                 tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
+                 double beta = 1.0, int iterations = 10,
+                 std::function<void(image<D, T>&, int)> callback = {},
+                 bool box_constraint = false, T box_min = -1, T box_max = 1,
+                 stopping_criterion* stop = nullptr) {
+    return detail::fista_(v, g, kernel, p, beta, iterations, callback,
+                          box_constraint, box_min, box_max, true, stop);
+}
+
+} // namespace reconstruction
+} // namespace tomo
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
 #include "../common.hpp"
 #include "../geometry.hpp"
 #include "../image.hpp"
 #include "../math.hpp"
 #include "../projections.hpp"
+#include "../projector.hpp"
+#include "../util/parallel.hpp"
 #include "../volume.hpp"
+#include "stopping_criterion.hpp"
 
 namespace tomo {
 namespace reconstruction {
@@ -22,6 +32,8 @@ namespace reconstruction {
  * \param p the measurements (projections)
  * \param beta (optional) a relaxation parameter
  * \param iterations (optional) the number of iterations to perform
+ * \param stop (optional) a criterion for stopping early, the residual and
+ * update norms passed to it are accumulated over the rows during a sweep
  *
  * \returns An image object representing the reconstructed object.
  */
@@ -29,7 +41,8 @@ template <dimension D, typename T>
 image<D, T> art(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                 tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
                 double beta = 0.5, int iterations = 10,
-                std::function<void(image<D, T>&, int)> callback = {}) {
+                std::function<void(image<D, T>&, int)> callback = {},
+                stopping_criterion* stop = nullptr) {
     image<D, T> f(v);
 
     // compute $w_i \cdot w_i$
@@ -40,7 +53,15 @@ image<D, T> art(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
         }
     }
 
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
     for (int k = 0; k < iterations; ++k) {
+        auto residual = (T)0;
+        auto update = (T)0;
         for (auto[row, line] : g) {
             T alpha = 0.0;
             for (auto elem : kernel(line))
@@ -49,11 +70,198 @@ image<D, T> art(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
             auto factor = beta * ((p[row] - alpha) / w_norms[row]);
             for (auto elem : kernel)
                 f[elem.index] += factor * elem.value;
+
+            if (stop && w_norms[row] > math::epsilon<T>) {
+                residual += (p[row] - alpha) * (p[row] - alpha);
+                update += factor * factor * w_norms[row];
+            }
         }
 
         if (callback) {
             callback(f, k); 
         }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+namespace detail {
+
+/** Atomically add `value` to `x`, with relaxed memory ordering. */
+template <typename T>
+void atomic_add(std::atomic<T>& x, T value) {
+    auto current = x.load(std::memory_order_relaxed);
+    while (!x.compare_exchange_weak(current, current + value,
+                                    std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace detail
+
+/**
+ * Asynchronous parallel ART. Each sweep visits the projections in a random
+ * order. The workers repeatedly take the next projection, and apply the ART
+ * update for each of its rows to the shared image without any locking
+ * (Hogwild-style), using relaxed atomic additions for the voxels. Since
+ * the matrix is sparse, the rows processed concurrently rarely touch the
+ * same voxels, and the updates are seldom based on outdated values.
+ *
+ * The random order only depends on `seed` and the sweep. Deterministic mode
+ * is serial: a single worker applies the updates in this order, so that the
+ * result is reproducible and does not depend on `threads`, which then only
+ * applies to computing the row norms.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ *
+ * \param v the volume of the imaged object
+ * \param g the geometry of the problem
+ * \param p the measurements (projections)
+ * \param beta (optional) a relaxation parameter
+ * \param iterations (optional) the number of sweeps to perform
+ * \param callback (optional) called after each sweep, changes it makes to
+ * the image are applied to the shared image
+ * \param threads (optional) the number of workers, defaults to all
+ * \param seed (optional) the seed of the random projection order
+ * \param deterministic (optional) whether to apply the updates serially, in
+ * the random order
+ * \param stop (optional) a criterion for stopping early, see `art`
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T> async_art(const volume<D, T>& v,
+                      const tomo::geometry::base<D, T>& g,
+                      tomo::dim::base<D, T>& kernel,
+                      const projections<D, T>& p, double beta = 0.5,
+                      int iterations = 10,
+                      std::function<void(image<D, T>&, int)> callback = {},
+                      int threads = 0, unsigned int seed = 0,
+                      bool deterministic = false,
+                      stopping_criterion* stop = nullptr) {
+    image<D, T> f(v);
+    auto x = std::vector<std::atomic<T>>(v.cells());
+    for (auto& value : x) {
+        value.store((T)0, std::memory_order_relaxed);
+    }
+
+    auto kernels = util::clone_kernels(kernel, util::thread_count(threads));
+    auto workers = deterministic ? 1 : (int)kernels.size();
+
+    // apply `row_action(kernel, row, line)` to each row of projection i
+    auto for_rows = [&](auto& k, int i, auto&& row_action) {
+        auto offset = g.offset(i);
+        auto last = g.iter_proj(i + 1);
+        for (auto it = g.iter_proj(i); it != last; ++it) {
+            auto[local_row, line] = *it;
+            row_action(k, offset + local_row, line);
+        }
+    };
+
+    // compute $w_i \cdot w_i$
+    std::vector<T> w_norms(g.lines());
+    util::parallel_for(0, g.projection_count(),
+                       [&](int t, int begin, int end) {
+                           for (int i = begin; i < end; ++i) {
+                               for_rows(*kernels[t], i,
+                                        [&](auto& k, uint64_t row, auto line) {
+                                            for (auto elem : k(line)) {
+                                                w_norms[row] +=
+                                                    elem.value * elem.value;
+                                            }
+                                        });
+                           }
+                       },
+                       (int)kernels.size());
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
+    auto order = std::vector<int>(g.projection_count());
+    auto residuals = std::vector<T>(workers);
+    auto updates = std::vector<T>(workers);
+    for (int k = 0; k < iterations; ++k) {
+        std::iota(order.begin(), order.end(), 0);
+        std::mt19937 gen(seed + k);
+        std::shuffle(order.begin(), order.end(), gen);
+
+        std::fill(residuals.begin(), residuals.end(), (T)0);
+        std::fill(updates.begin(), updates.end(), (T)0);
+
+        std::atomic<int> next(0);
+        util::parallel_for(
+            0, workers,
+            [&](int t, int, int) {
+                for (auto n = next++; n < (int)order.size(); n = next++) {
+                    for_rows(*kernels[t], order[n], [&](auto& kern,
+                                                        uint64_t row,
+                                                        auto line) {
+                        if (w_norms[row] <= math::epsilon<T>) {
+                            return;
+                        }
+                        T alpha = 0.0;
+                        for (auto elem : kern(line)) {
+                            alpha += x[elem.index].load(
+                                         std::memory_order_relaxed) *
+                                     elem.value;
+                        }
+
+                        auto factor =
+                            (T)beta * ((p[row] - alpha) / w_norms[row]);
+                        for (auto elem : kern) {
+                            detail::atomic_add(x[elem.index],
+                                               factor * elem.value);
+                        }
+
+                        residuals[t] += (p[row] - alpha) * (p[row] - alpha);
+                        updates[t] += factor * factor * w_norms[row];
+                    });
+                }
+            },
+            workers);
+
+        if (callback || stop) {
+            for (uint64_t j = 0; j < v.cells(); ++j) {
+                f[j] = x[j].load(std::memory_order_relaxed);
+            }
+        }
+
+        if (callback) {
+            callback(f, k);
+            // the callback may modify the image, e.g. to impose constraints
+            for (uint64_t j = 0; j < v.cells(); ++j) {
+                x[j].store(f[j], std::memory_order_relaxed);
+            }
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(
+                std::accumulate(residuals.begin(), residuals.end(), (T)0));
+            status.update_norm = math::sqrt(
+                std::accumulate(updates.begin(), updates.end(), (T)0));
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    for (uint64_t j = 0; j < v.cells(); ++j) {
+        f[j] = x[j].load(std::memory_order_relaxed);
     }
 
     return f;
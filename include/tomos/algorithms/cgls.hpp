@@ -5,8 +5,11 @@
 #include <vector>
 
 #include "../geometry.hpp"
+#include "../multichannel.hpp"
 #include "../projector.hpp"
+#include "../util/checkpoint.hpp"
 #include "../util/matrix_sums.hpp"
+#include "stopping_criterion.hpp"
 
 namespace tomo {
 namespace reconstruction {
@@ -41,6 +44,10 @@ namespace reconstruction {
  * \param p the measurements (projections)
  * \param beta (optional) a relaxation parameter
  * \param iterations (optional) the number of iterations to perform
+ * \param stop (optional) a criterion for stopping early
+ * \param checkpoints (optional) where to periodically save the iterate
+ * \f$\vec{x}_k\f$ together with \f$\vec{d}_k, \vec{r}_k, \vec{p}_k\f$, if
+ * constructed for resuming the reconstruction continues from the saved state
  *
  * \returns An image object representing the reconstructed object.
  */
@@ -48,7 +55,9 @@ template <dimension D, typename T>
 image<D, T> cgls(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                  tomo::dim::base<D, T>& kernel, const projections<D, T>& b,
                  int iterations = 10,
-                 std::function<void(image<D, T>&, int)> callback = {}) {
+                 std::function<void(image<D, T>&, int)> callback = {},
+                 stopping_criterion* stop = nullptr,
+                 checkpoint<T>* checkpoints = nullptr) {
     using namespace tomo::img;
 
     // x0 = 0
@@ -65,10 +74,30 @@ image<D, T> cgls(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
 
     // t0 = A p0
 
+    int first = 0;
+    if (checkpoints) {
+        if (auto state = checkpoints->restore(
+                "cgls", {v.cells(), g.lines(), v.cells(), v.cells()})) {
+            x.mutable_data() = std::move(state->vectors[0]);
+            d.mutable_data() = std::move(state->vectors[1]);
+            r.mutable_data() = std::move(state->vectors[2]);
+            p.mutable_data() = std::move(state->vectors[3]);
+            first = state->iteration + 1;
+        }
+    }
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
+    }
+
+    auto t = tomo::projections<D, T>(g);
+
     // for k : 1..
-    for (int k = 0; k < iterations; ++k) {
+    for (int k = first; k < iterations; ++k) {
         // (..7) t_k = A p_k
-        auto t = tomo::forward_projection(p, g, kernel);
+        tomo::forward_projection(p, g, kernel, t);
 
         // (1) \alpha_k = ||r_{k - 1} ||^2 / ||t_{k - 1}||^2
         auto r_norm = math::norm(r);
@@ -82,18 +111,107 @@ image<D, T> cgls(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
         d -= alpha * t;
 
         // (4) r_k = A^T d_k
-        r = tomo::back_projection(d, g, kernel, v);
+        tomo::back_projection(d, g, kernel, r);
 
         // (5) \beta_k = ||r_k||^2 / ||r_{k - 1}||^2
         auto rk_norm = math::norm(r);
         auto beta = (rk_norm * rk_norm) / (r_norm * r_norm);
 
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::norm(d);
+            status.update_norm = alpha * math::norm(p);
+            status.image_norm = math::norm(x);
+        }
+
         // (6) p_k = r_k + \beta_k * p_{k - 1}
         p = r + beta * p;
 
         if (callback) {
             callback(x, k);
         }
+
+        if (checkpoints && checkpoints->due(k)) {
+            checkpoints->save("cgls", k,
+                              {&x.data(), &d.data(), &r.data(), &p.data()});
+        }
+
+        if (stop && (*stop)(status)) {
+            break;
+        }
+    }
+
+    return x;
+}
+
+/**
+ * CGLS for multiple right-hand sides at once. Each channel runs its own
+ * CGLS iteration, with its own step sizes, but the forward and back
+ * projections of all channels share a single traversal of the geometry.
+ *
+ * \returns A multi-channel image, with a reconstruction for each channel.
+ */
+template <dimension D, typename T>
+multi_image<D, T>
+cgls(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+     tomo::dim::base<D, T>& kernel, const multi_projections<D, T>& b,
+     int iterations = 10,
+     std::function<void(multi_image<D, T>&, int)> callback = {}) {
+    auto channels = b.channels();
+
+    // x0 = 0, d0 = b, r0 = A^T b, p0 = r0
+    multi_image<D, T> x(v, channels);
+    auto d = b;
+    auto r = tomo::back_projection(b, g, kernel, v);
+    auto p = r;
+
+    auto r_norms = math::channel_squared_norms(r);
+    std::vector<T> alphas(channels);
+    std::vector<T> betas(channels);
+    multi_projections<D, T> t(g, channels);
+
+    for (int k = 0; k < iterations; ++k) {
+        tomo::forward_projection(p, g, kernel, t);
+
+        // a channel that has converged exactly is left alone
+        auto t_norms = math::channel_squared_norms(t);
+        for (int c = 0; c < channels; ++c) {
+            alphas[c] = (t_norms[c] > math::epsilon<T>)
+                            ? r_norms[c] / t_norms[c]
+                            : (T)0;
+        }
+
+        for (uint64_t j = 0; j < x.size(); j += channels) {
+            for (int c = 0; c < channels; ++c) {
+                x[j + c] += alphas[c] * p[j + c];
+            }
+        }
+
+        for (uint64_t i = 0; i < d.size(); i += channels) {
+            for (int c = 0; c < channels; ++c) {
+                d[i + c] -= alphas[c] * t[i + c];
+            }
+        }
+
+        tomo::back_projection(d, g, kernel, r);
+
+        auto rk_norms = math::channel_squared_norms(r);
+        for (int c = 0; c < channels; ++c) {
+            betas[c] = (r_norms[c] > math::epsilon<T>)
+                           ? rk_norms[c] / r_norms[c]
+                           : (T)0;
+        }
+        r_norms = rk_norms;
+
+        for (uint64_t j = 0; j < p.size(); j += channels) {
+            for (int c = 0; c < channels; ++c) {
+                p[j + c] = r[j + c] + betas[c] * p[j + c];
+            }
+        }
+
+        if (callback) {
+            callback(x, k);
+        }
     }
 
     return x;
@@ -110,6 +228,8 @@ image<D, T> cgls(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
  * \param p the measurements (projections)
  * \param beta (optional) a relaxation parameter
  * \param iterations (optional) the number of iterations to perform
+ * \param stop (optional) a criterion for stopping early
+ * \param sums_cache (optional) a cache to obtain the column sums from
  *
  * \returns An image object representing the reconstructed object.
  */
@@ -117,11 +237,14 @@ template <dimension D, typename T>
 image<D, T> cgls2(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                   tomo::dim::base<D, T>& kernel, const projections<D, T>& b,
                   int iterations = 10,
-                  std::function<void(image<D, T>&, int)> callback = {}) {
+                  std::function<void(image<D, T>&, int)> callback = {},
+                  stopping_criterion* stop = nullptr,
+                  matrix_sums_cache<D, T>* sums_cache = nullptr) {
     using namespace tomo::img;
     image<D, T> x(v);
 
-    auto cs = tomo::column_sums<D, T>(g, kernel);
+    auto cs = sums_cache ? (*sums_cache)(g, kernel).columns
+                         : tomo::column_sums<D, T>(g, kernel);
     for (auto& c : cs) {
         c = (math::abs(c) > math::epsilon<T>) ? ((T)1.0 / c) : (T)0.0;
     }
@@ -129,24 +252,44 @@ image<D, T> cgls2(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
     // From Li and Saad
     auto r = b;
     auto tr = tomo::back_projection(r, g, kernel, v);
-    auto z = cs * tr;
+    image<D, T> z = cs * tr;
     auto p = z;
 
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
+    }
+
+    auto w = tomo::projections<D, T>(g);
+
     for (int k = 0; k < iterations; ++k) {
-        auto w = tomo::forward_projection(p, g, kernel);
+        tomo::forward_projection(p, g, kernel, w);
         auto wnorm = math::norm(w);
         auto gamma = math::dot(z, tr);
         auto alpha = gamma / (wnorm * wnorm);
         x = x + alpha * p;
         r -= alpha * w;
-        tr = tomo::back_projection(r, g, kernel, v);
+        tomo::back_projection(r, g, kernel, tr);
         z = cs * tr;
         auto beta = math::dot(z, tr) / gamma;
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::norm(r);
+            status.update_norm = alpha * math::norm(p);
+            status.image_norm = math::norm(x);
+        }
+
         p = z + beta * p;
 
         if (callback) {
             callback(x, k);
         }
+
+        if (stop && (*stop)(status)) {
+            break;
+        }
     }
 
     return x;
@@ -157,30 +300,55 @@ template <dimension D, typename T>
 image<D, T> cg(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                tomo::dim::base<D, T>& kernel, const projections<D, T>& b,
                int iterations = 10,
-               std::function<void(image<D, T>&, int)> callback = {}) {
+               std::function<void(image<D, T>&, int)> callback = {},
+               stopping_criterion* stop = nullptr) {
     using namespace tomo::img;
 
     auto y = tomo::projections<D, T>(g);
     auto r = b;
     auto p = r;
 
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
+    }
+
+    auto bpp = tomo::image<D, T>(v);
+    auto abpp = tomo::projections<D, T>(g);
+    auto x = tomo::image<D, T>(v);
+
     for (int k = 0; k < iterations; ++k) {
         auto gamma = math::dot(r, r);
-        auto bpp = tomo::back_projection(p, g, kernel, v);
-        auto alpha = gamma / math::dot(bpp, bpp);
+        tomo::back_projection(p, g, kernel, bpp);
+        auto bpp_dot = math::dot(bpp, bpp);
+        auto alpha = gamma / bpp_dot;
         y += alpha * p;
-        r -= alpha * tomo::forward_projection(bpp, g, kernel);
-        auto beta = math::dot(r, r) / gamma;
+        tomo::forward_projection(bpp, g, kernel, abpp);
+        r -= alpha * abpp;
+        auto rr = math::dot(r, r);
+        auto beta = rr / gamma;
         p *= beta;
         p += r;
 
         if (callback) {
-            auto x = tomo::back_projection(y, g, kernel, v);
+            tomo::back_projection(y, g, kernel, x);
             callback(x, k);
         }
+
+        if (stop) {
+            // the image x = A^T y is only formed at the end, so its norm is
+            // not known here
+            status.iteration = k;
+            status.residual_norm = math::sqrt(rr);
+            status.update_norm = alpha * math::sqrt(bpp_dot);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
     }
 
-    auto x = tomo::back_projection(y, g, kernel, v);
+    tomo::back_projection(y, g, kernel, x);
     return x;
 }
 
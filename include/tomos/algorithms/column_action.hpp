@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <numeric>
 #include <optional>
 #include <random>
 #include <string>
@@ -12,39 +14,47 @@
 #include "../projections.hpp"
 #include "../util/column_iterator.hpp"
 #include "../util/image_processing.hpp"
+#include "../util/parallel.hpp"
 #include "../util/read_tiff.hpp"
 #include "../util/space_filling.hpp"
 #include "../volume.hpp"
+#include "stopping_criterion.hpp"
 
 using namespace tomo::img;
 
 namespace tomo {
 
+/**
+ * The order in which a column-action method visits the voxels: sweep `s`
+ * visits voxel `(*this)(s, i)` as its i-th voxel.
+ */
 struct index_space {
-    virtual int operator()(int /* s */, int i) { return i; }
+    virtual index_type operator()(int /* s */, index_type i) { return i; }
 
     virtual ~index_space() = default;
 };
 
 struct reverse_index_space : index_space {
-    reverse_index_space(int n_) : n(n_) {}
-    int n;
+    reverse_index_space(index_type n_) : n(n_) {}
+    index_type n;
 
-    int operator()(int /* s */, int i) override { return n - 1 - i; }
+    index_type operator()(int /* s */, index_type i) override {
+        return n - 1 - i;
+    }
 };
 
 struct back_forth_index_space : index_space {
-    back_forth_index_space(int n_) : n(n_) {}
-    int n;
+    back_forth_index_space(index_type n_) : n(n_) {}
+    index_type n;
 
-    int operator()(int s, int i) override {
+    index_type operator()(int s, index_type i) override {
         return s % 2 == 0 ? i : (n - 1 - i);
     }
 };
 
 struct random_index_space : index_space {
-    random_index_space(int n_) : n(n_) {
-        indices = std::vector<int>(n);
+    random_index_space(index_type n_) : n(n_) {
+        indices = std::vector<index_type>(n);
         std::iota(indices.begin(), indices.end(), 0);
 
         prev_s = -1;
@@ -56,11 +66,11 @@ struct random_index_space : index_space {
         std::shuffle(indices.begin(), indices.end(), g);
     }
 
-    int n;
+    index_type n;
     int prev_s;
-    std::vector<int> indices;
+    std::vector<index_type> indices;
 
-    int operator()(int s, int i) override {
+    index_type operator()(int s, index_type i) override {
         if (prev_s != s) {
             reset();
             prev_s = s;
@@ -72,18 +82,125 @@ struct random_index_space : index_space {
 struct hilbert_index_space : index_space {
     hilbert_index_space(int g) : g_(g), curve_({g, g}) {}
 
-    int operator()(int s, int i) override {
+    index_type operator()(int s, index_type i) override {
         (void)s;
-        auto x = curve_.from(i);
-        return x[1] * g_ + x[0];
+        auto x = curve_.from((int)i);
+        return (index_type)x[1] * g_ + x[0];
     }
 
     int g_;
     util::hilbert_curve curve_;
 };
 
+/**
+ * A partitioning of the voxels into colours, such that no two voxels of the
+ * same colour intersect a common line. Voxels of the same colour can then
+ * be updated concurrently by column-action methods.
+ *
+ * The colouring is computed greedily. Each pass assigns up to 64 colours,
+ * using a bit mask for each line of the colours that already hit it. Voxels
+ * that do not fit are deferred to the next pass.
+ */
+class voxel_colouring {
+  public:
+    /**
+     * Colour the voxels of `v`.
+     *
+     * \param cache (optional) precomputed columns, see `column_cache`
+     */
+    template <dimension D, typename T>
+    voxel_colouring(volume<D, T> v, const tomo::geometry::base<D, T>& g,
+                    tomo::dim::base<D, T>& kernel,
+                    const column_cache<D, T>* cache = nullptr) {
+        auto column = tomo::column<D, T>(g, kernel);
+        auto get_column = [&](uint64_t j) {
+            if (cache) {
+                return (*cache)(j, column);
+            }
+            column(v.unroll(j));
+            return typename column_cache<D, T>::range{
+                column.data(), column.data() + column.size()};
+        };
+        auto masks = std::vector<uint64_t>(g.lines());
+
+        auto pending = std::vector<uint64_t>(v.cells());
+        std::iota(pending.begin(), pending.end(), 0);
+        auto deferred = std::vector<uint64_t>();
+
+        while (!pending.empty()) {
+            std::fill(masks.begin(), masks.end(), 0);
+            auto base = colours_.size();
+            colours_.resize(base + 64);
+            deferred.clear();
+
+            for (auto j : pending) {
+                auto col = get_column(j);
+                uint64_t forbidden = 0;
+                for (auto[line_idx, value] : col) {
+                    if (value != (T)0) {
+                        forbidden |= masks[line_idx];
+                    }
+                }
+                if (forbidden == ~(uint64_t)0) {
+                    deferred.push_back(j);
+                    continue;
+                }
+
+                auto c = 0;
+                while (forbidden & ((uint64_t)1 << c)) {
+                    ++c;
+                }
+                for (auto[line_idx, value] : col) {
+                    if (value != (T)0) {
+                        masks[line_idx] |= (uint64_t)1 << c;
+                    }
+                }
+                colours_[base + c].push_back(j);
+            }
+
+            std::swap(pending, deferred);
+        }
+
+        colours_.erase(std::remove_if(colours_.begin(), colours_.end(),
+                                      [](const auto& c) { return c.empty(); }),
+                       colours_.end());
+    }
+
+    /** Obtain the number of colours. */
+    int size() const { return (int)colours_.size(); }
+
+    /** Obtain the voxels of colour `c`. */
+    const std::vector<uint64_t>& operator[](int c) const { return colours_[c]; }
+
+  private:
+    std::vector<std::vector<uint64_t>> colours_;
+};
+
 namespace reconstruction {
 
+namespace detail {
+
+/**
+ * Use the given column cache. If there is none, build one into `own` without
+ * a memory budget, so that only the column norms are computed and columns
+ * are recomputed on request: caching columns is left to the caller.
+ */
+template <dimension D, typename T>
+const column_cache<D, T>&
+obtain_cache(const column_cache<D, T>* cache,
+             std::optional<column_cache<D, T>>& own,
+             const tomo::geometry::base<D, T>& g,
+             tomo::dim::base<D, T>& kernel, int threads) {
+    if (cache) {
+        return *cache;
+    }
+    own.emplace(g, kernel, 0, threads);
+    return own.value();
+}
+
+} // namespace detail
+
+
 using namespace std::string_literals;
 
 template <dimension D, typename T>
@@ -93,54 +210,84 @@ image<D, T> column_action_cyclic(
     double beta = 0.5, int sweeps = 10, std::optional<image<D, T>> x0 = {},
     std::optional<index_space*> idxs = {},
     std::function<void(const image<D, T>&, int, const projections<D, T>&)>
-        callback = {}) {
+        callback = {},
+    stopping_criterion* stop = nullptr,
+    const column_cache<D, T>* cache = nullptr) {
     auto x = x0.value_or(tomo::image<D, T>(v, 0));
 
     tomo::write_png(x, "fan_beam_initial");
     auto ax = tomo::forward_projection(x, g, kernel);
 
-    auto r = b - ax;
+    projections<D, T> r = b - ax;
     auto column = tomo::column<D, T>(g, kernel);
-
-    auto cs = tomo::image<D, T>(v);
-    for (auto j = 0u; j < v.cells(); ++j) {
-        auto voxel_index = v.unroll(j);
-        for (auto[line_idx, value] : column(voxel_index)) {
-            (void)line_idx;
-            cs[j] += value * value;
-        }
+    std::optional<column_cache<D, T>> own_cache;
+    auto& cached = detail::obtain_cache(cache, own_cache, g, kernel, 0);
+    auto& cs = cached.squared_norms();
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
     }
 
     for (auto k = 0; k < sweeps; ++k) {
-        for (auto q = 0u; q < v.cells(); ++q) {
+        auto update = (T)0;
+        for (uint64_t q = 0; q < v.cells(); ++q) {
             auto j = q;
             if (idxs) {
                 j = (*idxs.value())(k, q);
             }
-            auto voxel_index = v.unroll(j);
             if (cs[j] < math::epsilon<T>) {
                 continue;
             }
+            auto col = cached(j, column);
             auto delta = (T)0;
-            for (auto[line_idx, value] : column(voxel_index)) {
+            for (auto[line_idx, value] : col) {
                 delta += value * r[line_idx];
             }
             delta /= cs[j];
             delta *= beta;
-            for (auto[line_idx, value] : column) {
+            for (auto[line_idx, value] : col) {
                 r[line_idx] -= value * delta;
             }
             x[j] += delta;
+            update += delta * delta;
         }
 
         if (callback) {
             callback(x, k, r);
         }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::norm(r);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(x);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
     }
 
     return x;
 }
 
+/**
+ * Block column-action. The updates for the voxels within a block are computed
+ * simultaneously, from the same residual.
+ *
+ * With more than one thread, consecutive blocks are processed concurrently
+ * in a block-Jacobi fashion: each thread updates the voxels of its block,
+ * and accumulates its changes to the residual privately. The private changes
+ * are added to the residual once all blocks of the stage are done. The
+ * blocks should then be disjoint, and `block` is only called from the
+ * calling thread.
+ *
+ * \param threads (optional) the number of blocks that are processed
+ * concurrently, non-positive values default to all hardware threads
+ * \param cache (optional) precomputed columns, see `column_cache`, by
+ * default the columns are recomputed when they are needed
+ */
 template <dimension D, typename T>
 image<D, T> column_action_block(
     volume<D, T>& v, const tomo::geometry::base<D, T>& g,
@@ -148,55 +295,220 @@ image<D, T> column_action_block(
     std::function<std::vector<uint64_t>(uint64_t)> block, uint64_t block_count,
     double beta = 0.5, int sweeps = 10, std::optional<image<D, T>> x0 = {},
     std::function<void(const image<D, T>&, int, const projections<D, T>&)>
-        callback = {}) {
+        callback = {},
+    stopping_criterion* stop = nullptr, int threads = 1,
+    const column_cache<D, T>* cache = nullptr) {
     auto x = x0.value_or(tomo::image<D, T>(v, 0));
     auto ax = tomo::forward_projection(x, g, kernel);
-    auto r = b - ax;
+    projections<D, T> r = b - ax;
+
+    auto workers = util::thread_count(threads);
+    auto kernels = util::clone_kernels(kernel, workers);
+    auto columns = std::vector<tomo::column<D, T>>();
+    columns.reserve(workers);
+    for (auto& k : kernels) {
+        columns.emplace_back(g, *k);
+    }
 
-    auto column = tomo::column<D, T>(g, kernel);
-    auto cs = tomo::image<D, T>(v);
-    for (auto j = 0u; j < v.cells(); ++j) {
-        auto voxel_index = v.unroll(j);
-        for (auto[line_idx, value] : column(voxel_index)) {
-            (void)line_idx;
-            cs[j] += value * value;
-        }
+    std::optional<column_cache<D, T>> own_cache;
+    auto& cached = detail::obtain_cache(cache, own_cache, g, kernel, threads);
+    auto& cs = cached.squared_norms();
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
     }
 
-    auto delta = std::vector<T>();
+    // per worker: updates within its block, changes to the residual and the
+    // lines it changed, and the squared norm of its updates
+    auto deltas = std::vector<std::vector<T>>(workers);
+    auto dr = std::vector<std::vector<T>>(workers, std::vector<T>(g.lines()));
+    auto touched = std::vector<std::vector<uint64_t>>(workers);
+    auto marked =
+        std::vector<std::vector<char>>(workers, std::vector<char>(g.lines()));
+    auto updates = std::vector<T>(workers);
+    auto stage_blocks = std::vector<std::vector<uint64_t>>(workers);
+
     for (auto k = 0; k < sweeps; ++k) {
-        for (auto i = 0u; i < block_count; ++i) {
-            auto vals = block(i);
-            delta.clear();
-            auto ni = vals.size();
-            delta.resize(ni);
-
-            for (auto idx = 0u; idx < ni; ++idx) {
-                auto j = vals[idx];
-                delta[idx] = (T)0;
-                auto voxel_index = v.unroll(j);
-                if (cs[j] < math::epsilon<T>) {
-                    continue;
-                }
-                for (auto[line_idx, value] : column(voxel_index)) {
-                    delta[idx] += value * r[line_idx];
-                }
-                delta[idx] /= cs[j];
-                delta[idx] *= beta;
+        std::fill(updates.begin(), updates.end(), (T)0);
+        for (uint64_t stage = 0; stage < block_count; stage += workers) {
+            auto count = std::min<uint64_t>(workers, block_count - stage);
+            for (uint64_t s = 0; s < count; ++s) {
+                stage_blocks[s] = block(stage + s);
             }
 
-            for (auto idx = 0u; idx < vals.size(); ++idx) {
-                auto j = vals[idx];
-                auto voxel_index = v.unroll(j);
-                for (auto[line_idx, value] : column(voxel_index)) {
-                    r[line_idx] -= value * delta[idx];
+            util::parallel_for(
+                (uint64_t)0, count,
+                [&](int t, uint64_t begin, uint64_t end) {
+                    auto& column = columns[t];
+                    auto& delta = deltas[t];
+                    for (auto s = begin; s < end; ++s) {
+                        auto& vals = stage_blocks[s];
+                        auto ni = vals.size();
+                        delta.resize(ni);
+
+                        for (uint64_t idx = 0; idx < ni; ++idx) {
+                            auto j = vals[idx];
+                            delta[idx] = (T)0;
+                            if (cs[j] < math::epsilon<T>) {
+                                continue;
+                            }
+                            for (auto[line_idx, value] : cached(j, column)) {
+                                delta[idx] += value * r[line_idx];
+                            }
+                            delta[idx] /= cs[j];
+                            delta[idx] *= beta;
+                        }
+
+                        for (uint64_t idx = 0; idx < ni; ++idx) {
+                            auto j = vals[idx];
+                            if (delta[idx] == (T)0) {
+                                continue;
+                            }
+                            for (auto[line_idx, value] : cached(j, column)) {
+                                if (!marked[t][line_idx]) {
+                                    marked[t][line_idx] = 1;
+                                    touched[t].push_back(line_idx);
+                                }
+                                dr[t][line_idx] -= value * delta[idx];
+                            }
+                            x[j] += delta[idx];
+                            updates[t] += delta[idx] * delta[idx];
+                        }
+                    }
+                },
+                workers);
+
+            for (int t = 0; t < workers; ++t) {
+                for (auto line_idx : touched[t]) {
+                    r[line_idx] += dr[t][line_idx];
+                    dr[t][line_idx] = (T)0;
+                    marked[t][line_idx] = 0;
                 }
-                x[j] += delta[idx];
+                touched[t].clear();
             }
         }
+
         if (callback) {
             callback(x, k, r);
         }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::norm(r);
+            status.update_norm = math::sqrt(
+                std::accumulate(updates.begin(), updates.end(), (T)0));
+            status.image_norm = math::norm(x);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return x;
+}
+
+/**
+ * Column-action where voxels that do not share any line are updated
+ * concurrently. The voxels are visited colour by colour, see
+ * `voxel_colouring`. Since the voxels of a colour are independent, the
+ * result does not depend on the number of threads.
+ *
+ * \param colouring (optional) a precomputed colouring for the volume,
+ * geometry and kernel, so that it can be reused over reconstructions
+ * \param threads (optional) the number of threads, defaults to all
+ * \param cache (optional) precomputed columns, see `column_cache`
+ */
+template <dimension D, typename T>
+image<D, T> column_action_coloured(
+    volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+    tomo::dim::base<D, T>& kernel, const projections<D, T>& b,
+    double beta = 0.5, int sweeps = 10, std::optional<image<D, T>> x0 = {},
+    const voxel_colouring* colouring = nullptr,
+    std::function<void(const image<D, T>&, int, const projections<D, T>&)>
+        callback = {},
+    stopping_criterion* stop = nullptr, int threads = 0,
+    const column_cache<D, T>* cache = nullptr) {
+    auto x = x0.value_or(tomo::image<D, T>(v, 0));
+    auto ax = tomo::forward_projection(x, g, kernel);
+    projections<D, T> r = b - ax;
+
+    std::optional<voxel_colouring> own_colouring;
+    if (!colouring) {
+        own_colouring.emplace(v, g, kernel, cache);
+        colouring = &own_colouring.value();
+    }
+
+    auto workers = util::thread_count(threads);
+    auto kernels = util::clone_kernels(kernel, workers);
+    auto columns = std::vector<tomo::column<D, T>>();
+    columns.reserve(workers);
+    for (auto& k : kernels) {
+        columns.emplace_back(g, *k);
+    }
+
+    std::optional<column_cache<D, T>> own_cache;
+    auto& cached = detail::obtain_cache(cache, own_cache, g, kernel, threads);
+    auto& cs = cached.squared_norms();
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
+    }
+
+    auto updates = std::vector<T>(workers);
+    for (auto k = 0; k < sweeps; ++k) {
+        std::fill(updates.begin(), updates.end(), (T)0);
+        for (auto c = 0; c < colouring->size(); ++c) {
+            auto& voxels = (*colouring)[c];
+            util::parallel_for(
+                (uint64_t)0, (uint64_t)voxels.size(),
+                [&](int t, uint64_t begin, uint64_t end) {
+                    auto& column = columns[t];
+                    for (auto q = begin; q < end; ++q) {
+                        auto j = voxels[q];
+                        if (cs[j] < math::epsilon<T>) {
+                            continue;
+                        }
+                        auto col = cached(j, column);
+                        auto delta = (T)0;
+                        // lines with a zero contribution may be shared with
+                        // other voxels of the colour, so they are not read
+                        for (auto[line_idx, value] : col) {
+                            if (value != (T)0) {
+                                delta += value * r[line_idx];
+                            }
+                        }
+                        delta /= cs[j];
+                        delta *= beta;
+                        for (auto[line_idx, value] : col) {
+                            if (value != (T)0) {
+                                r[line_idx] -= value * delta;
+                            }
+                        }
+                        x[j] += delta;
+                        updates[t] += delta * delta;
+                    }
+                },
+                workers);
+        }
+
+        if (callback) {
+            callback(x, k, r);
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::norm(r);
+            status.update_norm = math::sqrt(
+                std::accumulate(updates.begin(), updates.end(), (T)0));
+            status.image_norm = math::norm(x);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
     }
 
     return x;
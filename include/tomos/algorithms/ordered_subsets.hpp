@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../projections.hpp"
+#include "../projector.hpp"
+#include "../util/parallel.hpp"
+#include "stopping_criterion.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+/** The way projections are grouped into subsets, and the order of visiting. */
+enum class subset_ordering {
+    /** Contiguous ranges of projections, visited in geometry order. */
+    sequential,
+    /** Every n-th projection forms a subset, visited in order. */
+    interleaved,
+    /** Interleaved subsets, visited with a golden ratio stride. */
+    golden_angle,
+    /** Interleaved subsets, visited in a (seeded) random order. */
+    random
+};
+
+/**
+ * A partitioning of the projections of a geometry into ordered subsets.
+ */
+class ordered_subsets {
+  public:
+    /**
+     * Partition `projection_count` projections into `subset_count` subsets.
+     *
+     * \param seed the seed used for the random ordering, so that runs are
+     * reproducible.
+     */
+    ordered_subsets(int projection_count, int subset_count,
+                    subset_ordering ordering = subset_ordering::interleaved,
+                    unsigned int seed = 0)
+        : ordering_(ordering), seed_(seed) {
+        subset_count = std::max(1, std::min(subset_count, projection_count));
+        subsets_.resize(subset_count);
+
+        for (int i = 0; i < projection_count; ++i) {
+            if (ordering == subset_ordering::sequential) {
+                subsets_[((int64_t)i * subset_count) / projection_count]
+                    .push_back(i);
+            } else {
+                subsets_[i % subset_count].push_back(i);
+            }
+        }
+
+        order_.resize(subset_count);
+        std::iota(order_.begin(), order_.end(), 0);
+
+        if (ordering == subset_ordering::golden_angle) {
+            // visit the subset closest to k * (golden ratio) in turn, so that
+            // consecutive subsets are far apart in angle
+            const double golden = 0.5 * (std::sqrt(5.0) - 1.0);
+            std::vector<bool> taken(subset_count, false);
+            for (int k = 0; k < subset_count; ++k) {
+                double position = k * golden;
+                int s = (int)((position - std::floor(position)) * subset_count);
+                while (taken[s]) {
+                    s = (s + 1) % subset_count;
+                }
+                taken[s] = true;
+                order_[k] = s;
+            }
+        }
+    }
+
+    /** Obtain the number of subsets. */
+    int size() const { return (int)subsets_.size(); }
+
+    /** Obtain the indices of the projections in the s-th subset. */
+    const std::vector<int>& operator[](int s) const { return subsets_[s]; }
+
+    /** Obtain the order in which to visit the subsets in an iteration. */
+    std::vector<int> order(int iteration) const {
+        if (ordering_ != subset_ordering::random) {
+            return order_;
+        }
+        auto result = order_;
+        std::mt19937 gen(seed_ + iteration);
+        std::shuffle(result.begin(), result.end(), gen);
+        return result;
+    }
+
+  private:
+    std::vector<std::vector<int>> subsets_;
+    std::vector<int> order_;
+    subset_ordering ordering_;
+    unsigned int seed_;
+};
+
+/**
+ * Ordered subsets SIRT (OS-SIRT). The projections are partitioned into
+ * subsets \f$S\f$, and the SIRT update:
+ *
+ * \f[ \vec{x} \leftarrow \vec{x} + C_S W_S^T R_S(\vec{p}_S - W_S \vec{x}), \f]
+ *
+ * is applied for each subset in turn. Here \f$C_S\f$ are the inverse column
+ * sums restricted to the rows of the subset. With a single subset this is
+ * SIRT, with one projection per subset this is SART.
+ *
+ * The forward and back projection within a subset are distributed over the
+ * projections of the subset. Each thread accumulates its back projection,
+ * and the column sums restricted to the subset, in two private images, so
+ * this uses two additional images per thread whatever the number of
+ * subsets. Only the voxels touched by the subset are reduced and updated.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ *
+ * \param v the volume of the imaged object
+ * \param g the geometry of the problem
+ * \param p the measurements (projections)
+ * \param subsets the partitioning of the projections in subsets
+ * \param beta (optional) a relaxation parameter
+ * \param iterations (optional) the number of passes over all subsets
+ * \param threads (optional) the number of threads, defaults to one since each
+ * thread keeps two images and a byte per voxel
+ * \param stop (optional) a criterion for stopping early, the residual and
+ * update norms passed to it are accumulated over the subsets
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T> os_sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                    tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
+                    const ordered_subsets& subsets, double beta = 1.0,
+                    int iterations = 10,
+                    std::function<void(image<D, T>&, int)> callback = {},
+                    int threads = 1, stopping_criterion* stop = nullptr) {
+    image<D, T> f(v);
+
+    auto workers = util::thread_count(threads);
+    auto kernels = util::clone_kernels(kernel, workers);
+    // per thread: sparse accumulators for W_S^T s and W_S^T 1, and the
+    // voxels touched by the rows of the current subset
+    auto buffers = std::vector<image<D, T>>(workers, image<D, T>(v));
+    auto weights = std::vector<image<D, T>>(workers, image<D, T>(v));
+    auto marked =
+        std::vector<std::vector<char>>(workers, std::vector<char>(v.cells()));
+    auto touched = std::vector<std::vector<uint64_t>>(workers);
+
+    // apply `row_action(thread, kernel, row, line)` to each line of the
+    // projections in `members`, distributed over the workers
+    auto for_lines = [&](const std::vector<int>& members, auto&& row_action) {
+        util::parallel_for(
+            0, (int)members.size(),
+            [&](int t, int begin, int end) {
+                auto& k = *kernels[t];
+                for (int m = begin; m < end; ++m) {
+                    auto i = members[m];
+                    auto offset = g.offset(i);
+                    auto last = g.iter_proj(i + 1);
+                    for (auto it = g.iter_proj(i); it != last; ++it) {
+                        auto[local_row, line] = *it;
+                        row_action(t, k, offset + local_row, line);
+                    }
+                }
+            },
+            workers);
+    };
+
+    // back project `weight(row)` over `members`, along with the column sums
+    // restricted to `members`, and pass both totals for each voxel touched by
+    // the subset to `update(thread, j, total, column_sum)`
+    auto back_project = [&](const std::vector<int>& members, auto&& weight,
+                            auto&& update) {
+        for_lines(members, [&](int t, auto& k, uint64_t row, auto line) {
+            auto w = weight(row);
+            for (auto elem : k(line)) {
+                if (!marked[t][elem.index]) {
+                    marked[t][elem.index] = 1;
+                    touched[t].push_back(elem.index);
+                }
+                buffers[t][elem.index] += elem.value * w;
+                weights[t][elem.index] += elem.value;
+            }
+        });
+
+        // merge the touched voxels of the other threads into the first
+        auto& support = touched[0];
+        for (int t = 1; t < workers; ++t) {
+            for (auto j : touched[t]) {
+                if (!marked[0][j]) {
+                    marked[0][j] = 1;
+                    support.push_back(j);
+                }
+                marked[t][j] = 0;
+            }
+            touched[t].clear();
+        }
+
+        util::parallel_for(
+            (uint64_t)0, (uint64_t)support.size(),
+            [&](int t, uint64_t begin, uint64_t end) {
+                for (auto n = begin; n < end; ++n) {
+                    auto j = support[n];
+                    auto total = (T)0;
+                    auto column_sum = (T)0;
+                    for (int u = 0; u < workers; ++u) {
+                        total += buffers[u][j];
+                        column_sum += weights[u][j];
+                        buffers[u][j] = (T)0;
+                        weights[u][j] = (T)0;
+                    }
+                    marked[0][j] = 0;
+                    update(t, j, total, column_sum);
+                }
+            },
+            workers);
+        support.clear();
+    };
+
+    // compute R, the column sums restricted to a subset are accumulated
+    // along with its back projection
+    projections<D, T> rs(g);
+    for (int s = 0; s < subsets.size(); ++s) {
+        for_lines(subsets[s], [&](int, auto& k, uint64_t row, auto line) {
+            auto r = (T)0;
+            for (auto elem : k(line)) {
+                r += elem.value;
+            }
+            rs[row] = (math::abs(r) > math::epsilon<T>) ? ((T)1.0 / r) : (T)0.0;
+        });
+    }
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
+    // squared residual and update norms, accumulated per thread
+    std::vector<T> residuals(workers);
+    std::vector<T> updates(workers);
+
+    projections<D, T> s1(g);
+    for (int k = 0; k < iterations; ++k) {
+        std::fill(residuals.begin(), residuals.end(), (T)0);
+        std::fill(updates.begin(), updates.end(), (T)0);
+
+        for (auto s : subsets.order(k)) {
+            // compute R(p - Wx) for the rows in the subset
+            for_lines(subsets[s], [&](int t, auto& kern, uint64_t row,
+                                      auto line) {
+                auto alpha = (T)0;
+                for (auto elem : kern(line)) {
+                    alpha += f[elem.index] * elem.value;
+                }
+                auto d = p[row] - alpha;
+                residuals[t] += d * d;
+                s1[row] = d * rs[row];
+            });
+
+            // multiply with W^T, and update the image scaled by C
+            back_project(subsets[s], [&](uint64_t row) { return s1[row]; },
+                         [&](int t, uint64_t j, T total, T column_sum) {
+                             if (math::abs(column_sum) <= math::epsilon<T>) {
+                                 return;
+                             }
+                             auto delta = (T)beta * total / column_sum;
+                             updates[t] += delta * delta;
+                             f[j] += delta;
+                         });
+        }
+
+        if (callback) {
+            callback(f, k);
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(
+                std::accumulate(residuals.begin(), residuals.end(), (T)0));
+            status.update_norm = math::sqrt(
+                std::accumulate(updates.begin(), updates.end(), (T)0));
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+/**
+ * OS-SIRT, with `subset_count` subsets of the given ordering.
+ *
+ * \param seed (optional) the seed of a random ordering, see `ordered_subsets`
+ */
+template <dimension D, typename T>
+image<D, T> os_sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                    tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
+                    int subset_count,
+                    subset_ordering ordering = subset_ordering::interleaved,
+                    double beta = 1.0, int iterations = 10,
+                    std::function<void(image<D, T>&, int)> callback = {},
+                    int threads = 1, stopping_criterion* stop = nullptr,
+                    unsigned int seed = 0) {
+    return os_sirt(v, g, kernel, p,
+                   ordered_subsets(g.projection_count(), subset_count,
+                                   ordering, seed),
+                   beta, iterations, callback, threads, stop);
+}
+
+} // namespace reconstruction
+} // namespace tomo
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "../block_operator.hpp"
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../projector.hpp"
+#include "../util/projection_feed.hpp"
+#include "stopping_criterion.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+/**
+ * SART, see `sart`, on projections that are still arriving, e.g. while they
+ * are read from disk. The first sweep visits the projections in order of
+ * arrival, waiting for the next one when none is available, so that loading
+ * and reconstruction overlap. The remaining sweeps visit the arrived
+ * projections in the order of the geometry.
+ *
+ * The row norms are computed before the first projection is needed, so this
+ * also overlaps with loading.
+ *
+ * \param feed the arriving measurements
+ * \param callback (optional) called with the current image after each sweep
+ * \param preview_interval (optional) if positive, the callback is also
+ * called after every `preview_interval` projections of the first sweep, with
+ * iteration -1, so that a first image is available early
+ * \param threads (optional) the number of threads, defaults to one, see
+ * `block_operator` for the memory used per thread
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T> pipelined_sart(const volume<D, T>& v,
+                           const tomo::geometry::base<D, T>& g,
+                           tomo::dim::base<D, T>& kernel,
+                           util::projection_feed<D, T>& feed,
+                           double beta = 0.5, int iterations = 10,
+                           std::function<void(image<D, T>&, int)> callback = {},
+                           int preview_interval = 0,
+                           stopping_criterion* stop = nullptr,
+                           int threads = 1) {
+    image<D, T> f(v);
+    const auto& p = feed.data();
+
+    auto op = block_operator<D, T>(g, kernel, threads);
+    auto w_norms = op.squared_row_norms();
+
+    auto y = std::vector<T>();
+    auto residual = (T)0;
+    auto update = (T)0;
+    auto sart_update = [&](int block) {
+        auto offset = op.first_row(block);
+        op.forward(block, block + 1, f, y);
+        for (uint64_t i = 0; i < y.size(); ++i) {
+            auto row = offset + i;
+            if (w_norms[row] <= math::epsilon<T>) {
+                y[i] = (T)0;
+                continue;
+            }
+            auto d = p[row] - y[i];
+            y[i] = (T)beta * (d / w_norms[row]);
+            residual += d * d;
+            update += y[i] * y[i] * w_norms[row];
+        }
+
+        auto& delta = op.back(block, block + 1, y);
+        for (auto j : op.support()) {
+            f[j] += delta[j];
+        }
+    };
+
+    auto status = iteration_status{};
+    if (stop) {
+        stop->start();
+    }
+
+    // the projections that have arrived, in the order of the geometry
+    auto blocks = std::vector<int>();
+
+    for (int iter = 0; iter < iterations; ++iter) {
+        residual = (T)0;
+        update = (T)0;
+
+        if (iter == 0) {
+            for (int block = feed.next(); block >= 0; block = feed.next()) {
+                sart_update(block);
+                blocks.push_back(block);
+                if (callback && preview_interval > 0 &&
+                    blocks.size() % preview_interval == 0) {
+                    callback(f, -1);
+                }
+            }
+            feed.wait();
+            std::sort(blocks.begin(), blocks.end());
+            if (stop) {
+                status.data_norm = math::norm(p);
+            }
+        } else {
+            for (auto block : blocks) {
+                sart_update(block);
+            }
+        }
+
+        if (callback) {
+            callback(f, iter);
+        }
+
+        if (stop) {
+            status.iteration = iter;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+} // namespace reconstruction
+} // namespace tomo
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../operations.hpp"
+#include "../projections.hpp"
+#include "../projector.hpp"
+#include "../util/matrix_sums.hpp"
+#include "stopping_criterion.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+/** The algorithms that can be executed by a `plan`. */
+enum class plan_method { sirt, landweber, cgls, cgls2, cg };
+
+/**
+ * A reconstruction plan for a fixed volume, geometry, kernel and algorithm.
+ *
+ * Constructing a plan performs all the work that does not depend on the
+ * measurements, such as computing the row and column sums for SIRT, and
+ * allocates the workspaces of the algorithm. Executing the plan on new projection data
+ * then does not allocate any memory, which makes it suitable for
+ * reconstructing many data sets with identical geometry.
+ *
+ * The geometry and kernel are referenced by the plan, and should outlive it.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ */
+template <dimension D, typename T>
+class plan {
+  public:
+    /**
+     * Create a plan.
+     *
+     * \param beta a relaxation parameter (SIRT), or the step size (Landweber)
+     * \param iterations the number of iterations each execution performs
+     */
+    plan(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+         tomo::dim::base<D, T>& kernel, plan_method method,
+         double beta = 1.0, int iterations = 10)
+        : v_(v), g_(g), kernel_(kernel), method_(method), beta_(beta),
+          iterations_(iterations), s1_(g), r_(v), x_(v) {
+        if (method_ == plan_method::sirt) {
+            sums_.emplace(tomo::row_and_column_sums<D, T>(g_, kernel_));
+            for (auto& r : sums_->rows) {
+                r = (math::abs(r) > math::epsilon<T>) ? ((T)1.0 / r) : (T)0.0;
+            }
+            for (auto& bc : sums_->columns) {
+                bc = (math::abs(bc) > math::epsilon<T>) ? ((T)beta_ / bc)
+                                                         : (T)0.0;
+            }
+        }
+        if (method_ == plan_method::cgls2) {
+            column_sums_.emplace(tomo::column_sums<D, T>(g_, kernel_));
+            for (auto& c : *column_sums_) {
+                c = (math::abs(c) > math::epsilon<T>) ? ((T)1.0 / c) : (T)0.0;
+            }
+            z_.emplace(v);
+        }
+        if (method_ == plan_method::cgls || method_ == plan_method::cgls2) {
+            s2_.emplace(g);
+            q_.emplace(v);
+        }
+        if (method_ == plan_method::cg) {
+            s2_.emplace(g);
+            s3_.emplace(g);
+        }
+    }
+
+    /** Obtain the number of iterations each execution performs. */
+    int iterations() const { return iterations_; }
+
+    /** Set the number of iterations each execution performs. */
+    void set_iterations(int iterations) { iterations_ = iterations; }
+
+    /**
+     * Reconstruct from the measurements `p` into the image `x`, which
+     * should be defined on the volume of the plan. The initial contents of
+     * `x` are ignored.
+     *
+     * \param stop (optional) a criterion for stopping early, see the
+     * documentation of the corresponding algorithm for the quantities
+     * passed to it
+     */
+    void execute(const projections<D, T>& p, image<D, T>& x,
+                 std::function<void(image<D, T>&, int)> callback = {},
+                 stopping_criterion* stop = nullptr) {
+        x.clear();
+        switch (method_) {
+        case plan_method::sirt:
+            gradient_(p, x, true, callback, stop);
+            break;
+        case plan_method::landweber:
+            gradient_(p, x, false, callback, stop);
+            break;
+        case plan_method::cgls:
+            cgls_(p, x, callback, stop);
+            break;
+        case plan_method::cgls2:
+            cgls2_(p, x, callback, stop);
+            break;
+        case plan_method::cg:
+            cg_(p, x, callback, stop);
+            break;
+        }
+    }
+
+    /**
+     * Reconstruct from the measurements `p` into the image owned by the
+     * plan. The result is overwritten by the next execution.
+     */
+    const image<D, T>& execute(const projections<D, T>& p) {
+        execute(p, x_);
+        return x_;
+    }
+
+  private:
+    // SIRT, or Landweber when not preconditioned, see `sirt.hpp`
+    void gradient_(const projections<D, T>& p, image<D, T>& x,
+                   bool precondition,
+                   std::function<void(image<D, T>&, int)>& callback,
+                   stopping_criterion* stop) {
+        auto status = iteration_status{};
+        if (stop) {
+            status.data_norm = math::norm(p);
+            stop->start();
+        }
+
+        for (int k = 0; k < iterations_; ++k) {
+            tomo::forward_projection(x, g_, kernel_, s1_);
+
+            auto residual = (T)0;
+            for (uint64_t i = 0; i < g_.lines(); ++i) {
+                auto d = p[i] - s1_[i];
+                residual += d * d;
+                s1_[i] = precondition ? d * sums_->rows[i] : d;
+            }
+
+            tomo::back_projection(s1_, g_, kernel_, r_);
+
+            auto update = (T)0;
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                auto bc = precondition ? sums_->columns[j] : (T)beta_;
+                auto delta = bc * r_[j];
+                update += delta * delta;
+                x[j] += delta;
+            }
+
+            if (callback) {
+                callback(x, k);
+            }
+
+            if (stop) {
+                status.iteration = k;
+                status.residual_norm = math::sqrt(residual);
+                status.update_norm = math::sqrt(update);
+                status.image_norm = math::norm(x);
+                if ((*stop)(status)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // CGLS, see `cgls.hpp`, with d in s2_, t in s1_, r in r_ and p in q_
+    void cgls_(const projections<D, T>& b, image<D, T>& x,
+               std::function<void(image<D, T>&, int)>& callback,
+               stopping_criterion* stop) {
+        auto& s2 = *s2_;
+        auto& q = *q_;
+        std::copy(b.data().begin(), b.data().end(), s2.begin());
+        tomo::back_projection(b, g_, kernel_, r_);
+        std::copy(r_.data().begin(), r_.data().end(), q.begin());
+
+        auto status = iteration_status{};
+        if (stop) {
+            status.data_norm = math::norm(b);
+            stop->start();
+        }
+
+        auto r_norm = math::dot(r_, r_);
+        for (int k = 0; k < iterations_; ++k) {
+            tomo::forward_projection(q, g_, kernel_, s1_);
+
+            auto t_norm = math::dot(s1_, s1_);
+            auto alpha = (t_norm > math::epsilon<T>) ? r_norm / t_norm : (T)0;
+
+            auto update = (T)0;
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                update += q[j] * q[j];
+                x[j] += alpha * q[j];
+            }
+
+            for (uint64_t i = 0; i < g_.lines(); ++i) {
+                s2[i] -= alpha * s1_[i];
+            }
+
+            tomo::back_projection(s2, g_, kernel_, r_);
+
+            auto rk_norm = math::dot(r_, r_);
+            auto beta = (r_norm > math::epsilon<T>) ? rk_norm / r_norm : (T)0;
+            r_norm = rk_norm;
+
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                q[j] = r_[j] + beta * q[j];
+            }
+
+            if (callback) {
+                callback(x, k);
+            }
+
+            if (stop) {
+                status.iteration = k;
+                status.residual_norm = math::norm(s2);
+                status.update_norm = alpha * math::sqrt(update);
+                status.image_norm = math::norm(x);
+                if ((*stop)(status)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // preconditioned CGLS, see `cgls2` in `cgls.hpp`, with r in s2_, w in
+    // s1_, A^T r in r_, z in z_ and p in q_
+    void cgls2_(const projections<D, T>& b, image<D, T>& x,
+                std::function<void(image<D, T>&, int)>& callback,
+                stopping_criterion* stop) {
+        auto& s2 = *s2_;
+        auto& q = *q_;
+        auto& z = *z_;
+        auto& cs = *column_sums_;
+        std::copy(b.data().begin(), b.data().end(), s2.begin());
+        tomo::back_projection(b, g_, kernel_, r_);
+        for (uint64_t j = 0; j < v_.cells(); ++j) {
+            z[j] = cs[j] * r_[j];
+            q[j] = z[j];
+        }
+
+        auto status = iteration_status{};
+        if (stop) {
+            status.data_norm = math::norm(b);
+            stop->start();
+        }
+
+        for (int k = 0; k < iterations_; ++k) {
+            tomo::forward_projection(q, g_, kernel_, s1_);
+
+            auto w_norm = math::dot(s1_, s1_);
+            auto gamma = math::dot(z, r_);
+            auto alpha = (w_norm > math::epsilon<T>) ? gamma / w_norm : (T)0;
+
+            auto update = (T)0;
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                update += q[j] * q[j];
+                x[j] += alpha * q[j];
+            }
+
+            for (uint64_t i = 0; i < g_.lines(); ++i) {
+                s2[i] -= alpha * s1_[i];
+            }
+
+            tomo::back_projection(s2, g_, kernel_, r_);
+
+            auto zr = (T)0;
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                z[j] = cs[j] * r_[j];
+                zr += z[j] * r_[j];
+            }
+            auto beta = (gamma > math::epsilon<T>) ? zr / gamma : (T)0;
+
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                q[j] = z[j] + beta * q[j];
+            }
+
+            if (callback) {
+                callback(x, k);
+            }
+
+            if (stop) {
+                status.iteration = k;
+                status.residual_norm = math::norm(s2);
+                status.update_norm = alpha * math::sqrt(update);
+                status.image_norm = math::norm(x);
+                if ((*stop)(status)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // CG on A A^T y = b, see `cg` in `cgls.hpp`, with r in s2_, p in s3_,
+    // A^T p in r_ and A A^T p in s1_. Rather than y, the image x = A^T y is
+    // accumulated directly, so that no final back-projection is needed.
+    void cg_(const projections<D, T>& b, image<D, T>& x,
+             std::function<void(image<D, T>&, int)>& callback,
+             stopping_criterion* stop) {
+        auto& s2 = *s2_;
+        auto& s3 = *s3_;
+        std::copy(b.data().begin(), b.data().end(), s2.begin());
+        std::copy(b.data().begin(), b.data().end(), s3.begin());
+
+        auto status = iteration_status{};
+        if (stop) {
+            status.data_norm = math::norm(b);
+            stop->start();
+        }
+
+        for (int k = 0; k < iterations_; ++k) {
+            auto gamma = math::dot(s2, s2);
+            tomo::back_projection(s3, g_, kernel_, r_);
+            auto bpp_dot = math::dot(r_, r_);
+            auto alpha = (bpp_dot > math::epsilon<T>) ? gamma / bpp_dot : (T)0;
+
+            for (uint64_t j = 0; j < v_.cells(); ++j) {
+                x[j] += alpha * r_[j];
+            }
+
+            tomo::forward_projection(r_, g_, kernel_, s1_);
+            auto rr = (T)0;
+            for (uint64_t i = 0; i < g_.lines(); ++i) {
+                s2[i] -= alpha * s1_[i];
+                rr += s2[i] * s2[i];
+            }
+            auto beta = (gamma > math::epsilon<T>) ? rr / gamma : (T)0;
+
+            for (uint64_t i = 0; i < g_.lines(); ++i) {
+                s3[i] = s2[i] + beta * s3[i];
+            }
+
+            if (callback) {
+                callback(x, k);
+            }
+
+            if (stop) {
+                status.iteration = k;
+                status.residual_norm = math::sqrt(rr);
+                status.update_norm = alpha * math::sqrt(bpp_dot);
+                status.image_norm = math::norm(x);
+                if ((*stop)(status)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    volume<D, T> v_;
+    const tomo::geometry::base<D, T>& g_;
+    tomo::dim::base<D, T>& kernel_;
+    plan_method method_;
+    double beta_;
+    int iterations_;
+
+    // precomputed inverse row sums, and scaled inverse column sums (SIRT)
+    std::optional<matrix_sums<D, T>> sums_;
+
+    // precomputed inverse column sums (preconditioned CGLS)
+    std::optional<image<D, T>> column_sums_;
+
+    // workspaces, the optional ones are only used by the CG methods
+    projections<D, T> s1_;
+    std::optional<projections<D, T>> s2_;
+    std::optional<projections<D, T>> s3_;
+    image<D, T> r_;
+    std::optional<image<D, T>> q_;
+    std::optional<image<D, T>> z_;
+    image<D, T> x_;
+};
+
+} // namespace reconstruction
+} // namespace tomo
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <functional>
+
+#include "../geometries/roi.hpp"
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../operations.hpp"
+#include "../projections.hpp"
+#include "../projector.hpp"
+#include "../volume.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+/**
+ * Obtain the volume spanned by the voxels [first, first + voxels) of `v`, on
+ * the same grid.
+ */
+template <dimension D, typename T>
+volume<D, T> sub_volume(const volume<D, T>& v, math::vec<D, int> first,
+                        math::vec<D, int> voxels) {
+    auto voxel_size = v.physical_lengths() / math::vec<D, T>(v.voxels());
+    return volume<D, T>(voxels,
+                        v.origin() + math::vec<D, T>(first) * voxel_size,
+                        math::vec<D, T>(voxels) * voxel_size);
+}
+
+/**
+ * Obtain the measurements for the lines of a region of interest, with the
+ * contribution of the exterior of the region removed.
+ *
+ * The exterior is estimated by an image `exterior` on the full object, e.g. a
+ * coarse reconstruction on a downscaled volume. The voxels of this image
+ * whose centers lie in the region are ignored, and the remaining voxels are
+ * forward projected along the lines of the restricted geometry only.
+ *
+ * \param p the measurements of the full geometry of `g`
+ * \param exterior_kernel a kernel on the volume of `exterior`
+ */
+template <dimension D, typename T>
+projections<D, T> roi_data(const geometry::roi<D, T>& g,
+                           const projections<D, T>& p,
+                           const image<D, T>& exterior,
+                           tomo::dim::base<D, T>& exterior_kernel) {
+    auto v = exterior.get_volume();
+    auto region = g.region();
+    auto voxel_size = v.physical_lengths() / math::vec<D, T>(v.voxels());
+    auto lower = region.origin();
+    auto upper = region.origin() + region.physical_lengths();
+
+    auto masked = exterior;
+    for (uint64_t j = 0; j < v.cells(); ++j) {
+        auto center = v.origin() + (math::vec<D, T>(v.unroll(j)) + (T)0.5) *
+                                       voxel_size;
+        auto inside = true;
+        for (int d = 0; d < D; ++d) {
+            inside = inside && center[d] >= lower[d] && center[d] < upper[d];
+        }
+        if (inside) {
+            masked[j] = (T)0;
+        }
+    }
+
+    auto result = projections<D, T>(g);
+    tomo::forward_projection(masked, g, exterior_kernel, result);
+
+    for (int i = 0; i < g.projection_count(); ++i) {
+        auto offset = g.offset(i);
+        auto rows = math::reduce<D - 1>(g.projection_shape(i));
+        for (index_type r = 0; r < rows; ++r) {
+            result[offset + r] = p[g.global_line(i, r)] - result[offset + r];
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Reconstruct a region of interest only.
+ *
+ * The geometry is restricted to the lines hitting the region, and the
+ * contribution of the exterior of the region is subtracted from the
+ * measurements, see `roi_data`. The reconstruction method then only traces
+ * the remaining lines, and only through the voxels of the region.
+ *
+ * \tparam D the dimension of the problem
+ * \tparam T the scalar type in use
+ *
+ * \param g the (full) geometry of the problem
+ * \param p the measurements of the full geometry
+ * \param region the region of interest, see e.g. `sub_volume`
+ * \param exterior an estimate of the full object, e.g. a coarse
+ * reconstruction
+ * \param exterior_kernel a kernel on the volume of `exterior`
+ * \param solver a reconstruction method, called with the region, the
+ * restricted geometry and the corrected measurements
+ *
+ * \returns An image of the region of interest.
+ */
+template <dimension D, typename T>
+image<D, T>
+roi_reconstruction(const tomo::geometry::base<D, T>& g,
+                   const projections<D, T>& p, const volume<D, T>& region,
+                   const image<D, T>& exterior,
+                   tomo::dim::base<D, T>& exterior_kernel,
+                   std::function<image<D, T>(const volume<D, T>&,
+                                             const tomo::geometry::base<D, T>&,
+                                             const projections<D, T>&)>
+                       solver) {
+    auto restricted = geometry::roi<D, T>(g, region);
+    auto data = roi_data(restricted, p, exterior, exterior_kernel);
+    return solver(region, restricted, data);
+}
+
+} // namespace reconstruction
+} // namespace tomo
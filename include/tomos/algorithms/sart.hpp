@@ -1,9 +1,14 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
+#include <optional>
 #include <vector>
 
+#include "../block_operator.hpp"
 #include "../logging.hpp"
+#include "../util/image_processing.hpp"
+#include "stopping_criterion.hpp"
 
 namespace tomo {
 namespace reconstruction {
@@ -11,18 +16,26 @@ namespace reconstruction {
 /**
  * The Simultaneous Algebraic Reconstruction Technique (SART), is a tomographic
  * reconstruction method based on the classic Kaczmarz method for inverse
- * problems, but performed in blocks.
+ * problems, but performed in blocks. Here, each projection forms a block.
+ *
+ * The forward and back projections of a block are distributed over threads,
+ * see `block_operator`, and only the voxels hit by the block are updated.
  *
  * \tparam D the dimension of the problem
  * \tparam T the scalar type in use
- * \tparam Geometry the type of geometry of the problem
- * \tparam Projector the discrete integration method to use
  *
  * \param v the volume of the imaged object
  * \param g the geometry of the problem
  * \param p the measurements (projections)
  * \param beta (optional) a relaxation parameter
  * \param iterations (optional) the number of iterations to perform
+ * \param callback (optional) called with the current image after each
+ * iteration
+ * \param stop (optional) a criterion for stopping early, the residual and
+ * update norms passed to it are accumulated over the rows during a sweep
+ * \param x0 (optional) an initial image, to warm-start the reconstruction
+ * \param threads (optional) the number of threads, defaults to one, see
+ * `block_operator` for the memory used per thread
  *
  * \returns An image object representing the reconstructed object.
  */
@@ -30,146 +43,165 @@ template <dimension D, typename T>
 image<D, T> sart(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                  tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
                  double beta = 0.5, int iterations = 10,
-                 std::function<void(image<D, T>&, int)> callback = {}) {
-    image<D, T> f(v);
+                 std::function<void(image<D, T>&, int)> callback = {},
+                 stopping_criterion* stop = nullptr,
+                 std::optional<image<D, T>> x0 = {}, int threads = 1) {
+    image<D, T> f = x0 ? std::move(x0.value()) : image<D, T>(v);
 
-    // the size of a single block
-    int k = math::reduce<D - 1>(g.projection_shape(0));
+    auto op = block_operator<D, T>(g, kernel, threads);
 
     // compute $w_i \cdot w_i$
-    std::vector<T> w_norms(g.lines());
-    for (auto[line_number, line] : g) {
-        for (auto elem : kernel(line)) {
-            w_norms[line_number] += elem.value * elem.value;
-        }
-    }
+    auto w_norms = op.squared_row_norms();
 
-    auto f_next = f;
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
 
+    auto y = std::vector<T>();
     for (int iter = 0; iter < iterations; ++iter) {
-        int s = k;
-        int t = 0;
-
-        for (auto[row, line] : g) {
-            if (s == k) {
-                // we now update the image
-                if (t > 0) {
-                    f = f_next;
-                }
-                ++t;
-                s = 0;
-            }
+        auto residual = (T)0;
+        auto update = (T)0;
 
-            if (w_norms[row] > math::epsilon<T>) {
-                T alpha = 0.0;
-                for (auto elem : kernel(line)) {
-                    alpha += f[elem.index] * elem.value;
+        for (int block = 0; block < g.projection_count(); ++block) {
+            auto offset = op.first_row(block);
+            op.forward(block, block + 1, f, y);
+            for (uint64_t i = 0; i < y.size(); ++i) {
+                auto row = offset + i;
+                if (w_norms[row] <= math::epsilon<T>) {
+                    y[i] = (T)0;
+                    continue;
                 }
-
-                auto factor = beta * ((p[row] - alpha) / w_norms[row]);
-                for (auto elem : kernel(line))
-                    f_next[elem.index] += factor * elem.value;
+                auto d = p[row] - y[i];
+                y[i] = (T)beta * (d / w_norms[row]);
+                residual += d * d;
+                update += y[i] * y[i] * w_norms[row];
             }
 
-            ++s;
+            auto& delta = op.back(block, block + 1, y);
+            for (auto j : op.support()) {
+                f[j] += delta[j];
+            }
         }
 
         if (callback) {
-            callback(f_next, iter);
+            callback(f, iter);
+        }
+
+        if (stop) {
+            status.iteration = iter;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
         }
     }
 
     return f;
 }
 
-// SART with CG as precon
+/**
+ * SART, where the update for each block is obtained from a few iterations of
+ * CG on the normal equations of the block.
+ *
+ * \param x0 (optional) an initial image, to warm-start the reconstruction
+ * \param threads (optional) the number of threads, defaults to one, see
+ * `block_operator` for the memory used per thread
+ */
 template <dimension D, typename T>
 image<D, T> sart_cg(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                     tomo::dim::base<D, T>& kernel, const projections<D, T>& b,
                     int iterations = 10, T stepsize = 1.0,
-                    std::function<void(image<D, T>&, int)> callback = {}) {
-    std::vector<T> w_norms(g.lines());
-    for (auto[line_number, line] : g) {
-        for (auto elem : kernel(line)) {
-            w_norms[line_number] += elem.value * elem.value;
-        }
-    }
-
-    auto x = image<D, T>(v);
-    int block_size = math::reduce<D - 1>(g.projection_shape(0));
-
-    auto xb = image<D, T>(v);
-    auto yb = std::vector<T>(block_size);
-    auto zb = std::vector<T>(block_size);
-
-    auto fp_block = [&](int block, image<D, T>& z) -> std::vector<T>& {
-        std::fill(yb.begin(), yb.end(), 0);
-
-        for (auto it = g.iter_proj(block); it != g.iter_proj(block + 1); ++it) {
-            auto[row, line] = *it;
-            for (auto elem : kernel(line)) {
-                yb[row] += z[elem.index] * elem.value;
-            }
-        }
-
-        return yb;
-    };
-    auto bp_block = [&](int block, std::vector<T>& y) -> image<D, T>& {
-        std::fill(xb.begin(), xb.end(), 0);
-
-        for (auto it = g.iter_proj(block); it != g.iter_proj(block + 1); ++it) {
-            auto[row, line] = *it;
-            for (auto elem : kernel(line)) {
-                xb[elem.index] += y[row] * elem.value;
-            }
+                    std::function<void(image<D, T>&, int)> callback = {},
+                    stopping_criterion* stop = nullptr,
+                    std::optional<image<D, T>> x0 = {}, int threads = 1) {
+    auto x = x0 ? std::move(x0.value()) : image<D, T>(v);
+
+    auto op = block_operator<D, T>(g, kernel, threads);
+
+    // the squared norm of a back projection, which vanishes off its support
+    auto support_dot = [&](const image<D, T>& z) {
+        auto result = (T)0;
+        for (auto j : op.support()) {
+            result += z[j] * z[j];
         }
-
-        return xb;
+        return result;
     };
 
-    auto cg = [&](int block, std::vector<T>& bb, int initer) {
-        auto y = std::vector<T>(block_size);
-        auto r = bb;
-        auto p = r;
+    auto y = std::vector<T>();
+    auto r = std::vector<T>();
+    auto q = std::vector<T>();
+    auto t = std::vector<T>();
+    auto cg = [&](int block, const std::vector<T>& bb, int initer) {
+        y.assign(bb.size(), (T)0);
+        r = bb;
+        q = r;
 
         for (int k = 0; k < initer; ++k) {
             auto gamma = math::dot(r, r);
-            auto bpp = bp_block(block, p);
-            auto alpha = gamma / math::dot(bpp, bpp);
-            for (int i = 0; i < block_size; ++i) {
-                y[i] += alpha * p[i];
+            auto& bpq = op.back(block, block + 1, q);
+            auto bpq_dot = support_dot(bpq);
+            if (bpq_dot <= math::epsilon<T>) {
+                break;
+            }
+            auto alpha = gamma / bpq_dot;
+            for (uint64_t i = 0; i < y.size(); ++i) {
+                y[i] += alpha * q[i];
             }
-            for (int i = 0; i < block_size; ++i) {
-                auto t = fp_block(block, bpp);
+            op.forward(block, block + 1, bpq, t);
+            for (uint64_t i = 0; i < r.size(); ++i) {
                 r[i] -= alpha * t[i];
             }
             auto beta = math::dot(r, r) / gamma;
-            for (int i = 0; i < block_size; ++i) {
-                p[i] = r[i] + beta * p[i];
+            for (uint64_t i = 0; i < q.size(); ++i) {
+                q[i] = r[i] + beta * q[i];
             }
         }
-
-        return y;
     };
 
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(b);
+        stop->start();
+    }
+
+    auto alphas = std::vector<T>();
     for (int k = 0; k < iterations; ++k) {
+        auto residual = (T)0;
         for (int block = 0; block < g.projection_count(); ++block) {
             // compute residual for this block
-            auto& alphas = fp_block(block, x);
-            for (int i = 0; i < block_size; ++i) {
-                alphas[i] = b[block * block_size + i] - alphas[i];
+            auto offset = op.first_row(block);
+            op.forward(block, block + 1, x, alphas);
+            for (uint64_t i = 0; i < alphas.size(); ++i) {
+                alphas[i] = b[offset + i] - alphas[i];
+                residual += alphas[i] * alphas[i];
             }
             // perform some iterations of CG (i.e. finding how to adjust x to
             // reduce the residual for this block)
-            auto yl = cg(block, alphas, 1);
+            cg(block, alphas, 1);
 
             // Update the image
-            x += stepsize * bp_block(block, yl);
+            auto& delta = op.back(block, block + 1, y);
+            for (auto j : op.support()) {
+                x[j] += stepsize * delta[j];
+            }
         }
 
         if (callback) {
             callback(x, k);
         }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.image_norm = math::norm(x);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
     }
 
     return x;
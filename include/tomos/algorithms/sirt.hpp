@@ -5,8 +5,11 @@
 #include <vector>
 
 #include "../geometry.hpp"
+#include "../multichannel.hpp"
 #include "../projector.hpp"
+#include "../util/checkpoint.hpp"
 #include "../util/matrix_sums.hpp"
+#include "stopping_criterion.hpp"
 
 namespace tomo {
 namespace reconstruction {
@@ -33,6 +36,11 @@ namespace reconstruction {
  * \param p the measurements (projections)
  * \param beta (optional) a relaxation parameter
  * \param iterations (optional) the number of iterations to perform
+ * \param stop (optional) a criterion for stopping early, the residual passed
+ * to it is that of the image at the start of the iteration
+ * \param checkpoints (optional) where to periodically save the image, if
+ * constructed for resuming the reconstruction continues from the saved image
+ * \param sums_cache (optional) a cache to obtain the row and column sums from
  *
  * \returns An image object representing the reconstructed object.
  */
@@ -41,12 +49,25 @@ image<D, T> sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
                  tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
                  double beta = 1.0, int iterations = 10,
                  std::function<void(image<D, T>&, int)> callback = {},
-                 bool box_constraint = false, T box_min = -1, T box_max = 1) {
+                 bool box_constraint = false, T box_min = -1, T box_max = 1,
+                 stopping_criterion* stop = nullptr,
+                 checkpoint<T>* checkpoints = nullptr,
+                 matrix_sums_cache<D, T>* sums_cache = nullptr) {
     image<D, T> f(v);
 
+    int first = 0;
+    if (checkpoints) {
+        if (auto state = checkpoints->restore("sirt", {v.cells()})) {
+            f.mutable_data() = std::move(state->vectors[0]);
+            first = state->iteration + 1;
+        }
+    }
+
     // first we compute R and C
-    auto rs = tomo::row_sums<D, T>(g, kernel);
-    auto bcs = tomo::column_sums<D, T>(g, kernel);
+    auto sums = sums_cache ? (*sums_cache)(g, kernel)
+                           : tomo::row_and_column_sums<D, T>(g, kernel);
+    auto& rs = sums.rows;
+    auto& bcs = sums.columns;
 
     for (auto& r : rs) {
         r = (math::abs(r) > math::epsilon<T>) ? ((T)1.0 / r) : (T)0.0;
@@ -56,9 +77,15 @@ image<D, T> sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
         bc = (math::abs(bc) > math::epsilon<T>) ? ((T)beta / bc) : (T)0.0;
     }
 
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
     projections<D, T> s1(g);
     image<D, T> s2(v);
-    for (int k = 0; k < iterations; ++k) {
+    for (int k = first; k < iterations; ++k) {
         // compute Wx
         for (auto[idx, line] : g) {
             for (auto elem : kernel(line)) {
@@ -67,8 +94,11 @@ image<D, T> sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
         }
 
         // compute R(p - Wx)
-        for (auto j = 0u; j < g.lines(); ++j) {
-            s1[j] = (p[j] - s1[j]) * rs[j];
+        auto residual = (T)0;
+        for (uint64_t j = 0; j < g.lines(); ++j) {
+            auto d = p[j] - s1[j];
+            residual += d * d;
+            s1[j] = d * rs[j];
         }
 
         // multiply with W^T
@@ -79,8 +109,109 @@ image<D, T> sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
         }
 
         // update image while scaling with beta * C
-        for (auto j = 0u; j < v.cells(); ++j) {
-            f[j] += bcs[j] * s2[j];
+        auto update = (T)0;
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto delta = bcs[j] * s2[j];
+            update += delta * delta;
+            f[j] += delta;
+        }
+
+        s1.clear();
+        s2.clear();
+
+        if (box_constraint) {
+            math::box(f, box_min, box_max);
+        }
+
+        if (callback) {
+            callback(f, k);
+        }
+
+        if (checkpoints && checkpoints->due(k)) {
+            checkpoints->save("sirt", k, {&f.data()});
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+/**
+ * SIRT for multiple right-hand sides at once, e.g. several energy channels
+ * measured with the same geometry. Each channel is reconstructed
+ * independently, see `sirt`, but the geometry is traversed only once per
+ * iteration for all channels.
+ *
+ * \returns A multi-channel image, with a reconstruction for each channel.
+ */
+template <dimension D, typename T>
+multi_image<D, T>
+sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+     tomo::dim::base<D, T>& kernel, const multi_projections<D, T>& p,
+     double beta = 1.0, int iterations = 10,
+     std::function<void(multi_image<D, T>&, int)> callback = {},
+     bool box_constraint = false, T box_min = -1, T box_max = 1) {
+    auto channels = p.channels();
+    multi_image<D, T> f(v, channels);
+
+    // R and C are shared by all channels
+    auto sums = tomo::row_and_column_sums<D, T>(g, kernel);
+    auto& rs = sums.rows;
+    auto& bcs = sums.columns;
+
+    for (auto& r : rs) {
+        r = (math::abs(r) > math::epsilon<T>) ? ((T)1.0 / r) : (T)0.0;
+    }
+
+    for (auto& bc : bcs) {
+        bc = (math::abs(bc) > math::epsilon<T>) ? ((T)beta / bc) : (T)0.0;
+    }
+
+    multi_projections<D, T> s1(g, channels);
+    multi_image<D, T> s2(v, channels);
+    for (int k = 0; k < iterations; ++k) {
+        // compute R(p - Wx)
+        for (auto[idx, line] : g) {
+            auto s = s1.line(idx);
+            for (auto elem : kernel(line)) {
+                auto x = f.voxel(elem.index);
+                for (int c = 0; c < channels; ++c) {
+                    s[c] += x[c] * elem.value;
+                }
+            }
+            auto b = p.line(idx);
+            for (int c = 0; c < channels; ++c) {
+                s[c] = (b[c] - s[c]) * rs[idx];
+            }
+        }
+
+        // multiply with W^T
+        for (auto[idx, line] : g) {
+            auto s = s1.line(idx);
+            for (auto elem : kernel(line)) {
+                auto x = s2.voxel(elem.index);
+                for (int c = 0; c < channels; ++c) {
+                    x[c] += elem.value * s[c];
+                }
+            }
+        }
+
+        // update image while scaling with beta * C
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto x = f.voxel(j);
+            auto s = s2.voxel(j);
+            for (int c = 0; c < channels; ++c) {
+                x[c] += bcs[j] * s[c];
+            }
         }
 
         s1.clear();
@@ -103,12 +234,28 @@ image<D, T> landweber(const volume<D, T>& v, const tomo::geometry::base<D, T>& g
                  tomo::dim::base<D, T>& kernel, const projections<D, T>& p,
                  double beta = 1.0, int iterations = 10,
                  std::function<void(image<D, T>&, int)> callback = {},
-                 bool box_constraint = false, T box_min = -1, T box_max = 1) {
+                 bool box_constraint = false, T box_min = -1, T box_max = 1,
+                 stopping_criterion* stop = nullptr,
+                 checkpoint<T>* checkpoints = nullptr) {
     image<D, T> f(v);
 
+    int first = 0;
+    if (checkpoints) {
+        if (auto state = checkpoints->restore("landweber", {v.cells()})) {
+            f.mutable_data() = std::move(state->vectors[0]);
+            first = state->iteration + 1;
+        }
+    }
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = math::norm(p);
+        stop->start();
+    }
+
     projections<D, T> s1(g);
     image<D, T> s2(v);
-    for (int k = 0; k < iterations; ++k) {
+    for (int k = first; k < iterations; ++k) {
         // compute Wx
         for (auto[idx, line] : g) {
             for (auto elem : kernel(line)) {
@@ -117,8 +264,10 @@ image<D, T> landweber(const volume<D, T>& v, const tomo::geometry::base<D, T>& g
         }
 
         // compute p - Wx
-        for (auto j = 0u; j < g.lines(); ++j) {
+        auto residual = (T)0;
+        for (uint64_t j = 0; j < g.lines(); ++j) {
             s1[j] = p[j] - s1[j];
+            residual += s1[j] * s1[j];
         }
 
         // multiply with W^T
@@ -129,8 +278,11 @@ image<D, T> landweber(const volume<D, T>& v, const tomo::geometry::base<D, T>& g
         }
 
         // update image
-        for (auto j = 0u; j < v.cells(); ++j) {
-            f[j] += s2[j] * beta;
+        auto update = (T)0;
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto delta = s2[j] * (T)beta;
+            update += delta * delta;
+            f[j] += delta;
         }
 
         s1.clear();
@@ -143,6 +295,20 @@ image<D, T> landweber(const volume<D, T>& v, const tomo::geometry::base<D, T>& g
         if (callback) {
             callback(f, k);
         }
+
+        if (checkpoints && checkpoints->due(k)) {
+            checkpoints->save("landweber", k, {&f.data()});
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
     }
 
     return f;
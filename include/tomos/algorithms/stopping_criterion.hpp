@@ -0,0 +1,147 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace tomo {
+namespace reconstruction {
+
+/**
+ * The state of an iterative algorithm after an iteration, as far as it is
+ * known to the algorithm without additional projections. Unknown quantities
+ * are negative.
+ */
+struct iteration_status {
+    /** The iteration (or sweep) that was just completed. */
+    int iteration = 0;
+
+    /** The norm of the residual \f$\vec{p} - W \vec{x}\f$. */
+    double residual_norm = -1;
+
+    /** The norm of the measurements \f$\vec{p}\f$. */
+    double data_norm = -1;
+
+    /** The norm of the change in the image in this iteration. */
+    double update_norm = -1;
+
+    /** The norm of the image. */
+    double image_norm = -1;
+};
+
+/**
+ * A criterion that decides when an iterative algorithm should stop early.
+ * The algorithm still performs at most the requested number of iterations.
+ *
+ * Algorithms evaluate their residual from quantities they already compute.
+ * For some algorithms (e.g. SIRT) this is the residual of the image at the
+ * start of the iteration, for row-action methods (ART, SART) it is
+ * accumulated during the sweep; see the documentation of the algorithm.
+ */
+struct stopping_criterion {
+    /** Called by the algorithm before the first iteration. */
+    virtual void start() {}
+
+    /** Returns true if the algorithm should stop after this iteration. */
+    virtual bool operator()(const iteration_status& status) = 0;
+
+    virtual ~stopping_criterion() = default;
+};
+
+/** Stop when \f$\|\vec{p} - W \vec{x}\| / \|\vec{p}\|\f$ drops below `tol`. */
+struct relative_residual : stopping_criterion {
+    relative_residual(double tol_) : tol(tol_) {}
+    double tol;
+
+    bool operator()(const iteration_status& status) override {
+        if (status.residual_norm < 0 || status.data_norm <= 0) {
+            return false;
+        }
+        return status.residual_norm / status.data_norm < tol;
+    }
+};
+
+/**
+ * Stop when \f$\|\vec{x}_{k + 1} - \vec{x}_k\| / \|\vec{x}_{k + 1}\|\f$ drops
+ * below `tol`.
+ */
+struct relative_update : stopping_criterion {
+    relative_update(double tol_) : tol(tol_) {}
+    double tol;
+
+    bool operator()(const iteration_status& status) override {
+        if (status.update_norm < 0 || status.image_norm <= 0) {
+            return false;
+        }
+        return status.update_norm / status.image_norm < tol;
+    }
+};
+
+/**
+ * Morozov's discrepancy principle, stop as soon as the residual is at the
+ * level of the noise, i.e. \f$\|\vec{p} - W \vec{x}\| \leq \tau \delta\f$.
+ */
+struct discrepancy_principle : stopping_criterion {
+    /**
+     * \param noise_norm_ an estimate \f$\delta\f$ of the norm of the noise
+     * \param tau_ a safety factor, slightly larger than one
+     */
+    discrepancy_principle(double noise_norm_, double tau_ = 1.01)
+        : noise_norm(noise_norm_), tau(tau_) {}
+
+    /**
+     * Construct the principle for measurements with i.i.d. noise of standard
+     * deviation `sigma` on each of `lines` measurements.
+     */
+    static discrepancy_principle from_noise_level(double sigma, uint64_t lines,
+                                                  double tau = 1.01) {
+        return discrepancy_principle(sigma * std::sqrt((double)lines), tau);
+    }
+
+    double noise_norm;
+    double tau;
+
+    bool operator()(const iteration_status& status) override {
+        if (status.residual_norm < 0) {
+            return false;
+        }
+        return status.residual_norm <= tau * noise_norm;
+    }
+};
+
+/** Stop when a wall-clock budget is exhausted. */
+struct time_budget : stopping_criterion {
+    time_budget(std::chrono::duration<double> budget_) : budget(budget_) {}
+    std::chrono::duration<double> budget;
+    std::chrono::steady_clock::time_point started;
+
+    void start() override { started = std::chrono::steady_clock::now(); }
+
+    bool operator()(const iteration_status&) override {
+        return std::chrono::steady_clock::now() - started >= budget;
+    }
+};
+
+/** Stop when any of the given criteria is met. */
+struct first_of : stopping_criterion {
+    first_of(std::vector<stopping_criterion*> criteria_) : criteria(criteria_) {}
+    std::vector<stopping_criterion*> criteria;
+
+    void start() override {
+        for (auto criterion : criteria) {
+            criterion->start();
+        }
+    }
+
+    bool operator()(const iteration_status& status) override {
+        bool done = false;
+        for (auto criterion : criteria) {
+            done = (*criterion)(status) || done;
+        }
+        return done;
+    }
+};
+
+} // namespace reconstruction
+} // namespace tomo
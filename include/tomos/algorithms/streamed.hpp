@@ -0,0 +1,240 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../projection_store.hpp"
+#include "../projector.hpp"
+#include "stopping_criterion.hpp"
+
+namespace tomo {
+namespace reconstruction {
+
+namespace detail {
+
+/**
+ * Call `f(row, line)` for each line of the projections in chunk `c` of
+ * `p`, where `row` is the index of the line within the chunk.
+ */
+template <dimension D, typename T, typename F>
+void for_chunk_lines(const tomo::geometry::base<D, T>& g,
+                     const projection_store<D, T>& p, int c, F&& f) {
+    auto last = g.iter_proj(p.last_projection(c));
+    for (auto it = g.iter_proj(p.first_projection(c)); it != last; ++it) {
+        auto[row, line] = *it;
+        f(row, line);
+    }
+}
+
+/** The norm of the measurements in a store, reading each chunk once. */
+template <dimension D, typename T>
+T data_norm(projection_store<D, T>& p) {
+    auto result = (T)0;
+    for (int c = 0; c < p.chunks(); ++c) {
+        auto values = p.chunk(c);
+        p.prefetch(c + 1);
+        for (auto x : *values) {
+            result += x * x;
+        }
+    }
+    return math::sqrt(result);
+}
+
+} // namespace detail
+
+/**
+ * SIRT, see `sirt`, for measurements that are streamed from a
+ * `projection_store`. Each iteration reads the chunks of the store in
+ * order, while the next chunk is prefetched, so that only the window of the
+ * store is in memory.
+ *
+ * The forward and back projection of a line are fused, and the row sums are
+ * computed along with the forward projection, so that no vector of the size
+ * of the measurements is allocated.
+ *
+ * \param p the measurements, streamed in chunks
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T> sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                 tomo::dim::base<D, T>& kernel, projection_store<D, T>& p,
+                 double beta = 1.0, int iterations = 10,
+                 std::function<void(image<D, T>&, int)> callback = {},
+                 stopping_criterion* stop = nullptr) {
+    image<D, T> f(v);
+
+    // compute C, this does not need the measurements
+    image<D, T> cs(v);
+    for (auto[idx, line] : g) {
+        (void)idx;
+        for (auto elem : kernel(line)) {
+            cs[elem.index] += elem.value;
+        }
+    }
+    for (auto& c : cs) {
+        c = (math::abs(c) > math::epsilon<T>) ? ((T)beta / c) : (T)0.0;
+    }
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = detail::data_norm(p);
+        stop->start();
+    }
+
+    image<D, T> s2(v);
+    for (int k = 0; k < iterations; ++k) {
+        // accumulate W^T R(p - Wx), chunk by chunk
+        auto residual = (T)0;
+        for (int c = 0; c < p.chunks(); ++c) {
+            auto values = p.chunk(c);
+            p.prefetch(c + 1);
+            detail::for_chunk_lines(g, p, c, [&](uint64_t row, auto line) {
+                auto alpha = (T)0;
+                auto r = (T)0;
+                for (auto elem : kernel(line)) {
+                    alpha += f[elem.index] * elem.value;
+                    r += elem.value;
+                }
+                auto d = (*values)[row] - alpha;
+                residual += d * d;
+                if (math::abs(r) <= math::epsilon<T>) {
+                    return;
+                }
+                auto w = d / r;
+                for (auto elem : kernel(line)) {
+                    s2[elem.index] += elem.value * w;
+                }
+            });
+        }
+
+        // update image while scaling with beta * C
+        auto update = (T)0;
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto delta = cs[j] * s2[j];
+            update += delta * delta;
+            f[j] += delta;
+        }
+        s2.clear();
+
+        if (callback) {
+            callback(f, k);
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+/**
+ * OS-SIRT, see `os_sirt`, for measurements that are streamed from a
+ * `projection_store`. The chunks of the store are the subsets, visited in
+ * order, so that the next chunk can be prefetched while the current one is
+ * being processed.
+ *
+ * Like `os_sirt`, the column sums restricted to a chunk are accumulated
+ * along with its back projection, and only the voxels touched by the chunk
+ * are updated.
+ *
+ * \param p the measurements, streamed in chunks
+ *
+ * \returns An image object representing the reconstructed object.
+ */
+template <dimension D, typename T>
+image<D, T> os_sirt(const volume<D, T>& v, const tomo::geometry::base<D, T>& g,
+                    tomo::dim::base<D, T>& kernel, projection_store<D, T>& p,
+                    double beta = 1.0, int iterations = 10,
+                    std::function<void(image<D, T>&, int)> callback = {},
+                    stopping_criterion* stop = nullptr) {
+    image<D, T> f(v);
+
+    auto status = iteration_status{};
+    if (stop) {
+        status.data_norm = detail::data_norm(p);
+        stop->start();
+    }
+
+    std::vector<T> s1;
+    image<D, T> s2(v);
+    image<D, T> cs(v);
+    std::vector<char> marked(v.cells());
+    std::vector<uint64_t> touched;
+    for (int k = 0; k < iterations; ++k) {
+        auto residual = (T)0;
+        auto update = (T)0;
+
+        for (int c = 0; c < p.chunks(); ++c) {
+            auto values = p.chunk(c);
+            p.prefetch(c + 1);
+
+            // compute R(p - Wx) for the rows in the chunk
+            s1.assign(values->size(), (T)0);
+            detail::for_chunk_lines(g, p, c, [&](uint64_t row, auto line) {
+                auto alpha = (T)0;
+                auto r = (T)0;
+                for (auto elem : kernel(line)) {
+                    alpha += f[elem.index] * elem.value;
+                    r += elem.value;
+                }
+                auto d = (*values)[row] - alpha;
+                residual += d * d;
+                s1[row] = (math::abs(r) > math::epsilon<T>) ? d / r : (T)0;
+            });
+
+            // multiply with W^T and accumulate C, and update the touched
+            // voxels of the image scaled by C
+            detail::for_chunk_lines(g, p, c, [&](uint64_t row, auto line) {
+                for (auto elem : kernel(line)) {
+                    if (!marked[elem.index]) {
+                        marked[elem.index] = 1;
+                        touched.push_back(elem.index);
+                    }
+                    s2[elem.index] += elem.value * s1[row];
+                    cs[elem.index] += elem.value;
+                }
+            });
+            for (auto j : touched) {
+                if (math::abs(cs[j]) > math::epsilon<T>) {
+                    auto delta = (T)beta * s2[j] / cs[j];
+                    update += delta * delta;
+                    f[j] += delta;
+                }
+                s2[j] = (T)0;
+                cs[j] = (T)0;
+                marked[j] = 0;
+            }
+            touched.clear();
+        }
+
+        if (callback) {
+            callback(f, k);
+        }
+
+        if (stop) {
+            status.iteration = k;
+            status.residual_norm = math::sqrt(residual);
+            status.update_norm = math::sqrt(update);
+            status.image_norm = math::norm(f);
+            if ((*stop)(status)) {
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+} // namespace reconstruction
+} // namespace tomo
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "image.hpp"
+#include "projector.hpp"
+#include "util/parallel.hpp"
+#include "volume.hpp"
+
+namespace tomo {
+
+/**
+ * The projection operator restricted to a range of projections (a block),
+ * as used by block-iterative methods such as SART.
+ *
+ * The rows of a block are distributed over threads. A back projection only
+ * touches the voxels hit by the rows of the block, and its result is kept
+ * sparse: only the voxels in `support()` are nonzero, and only these are
+ * cleared before the next back projection.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class block_operator {
+  public:
+    /**
+     * Construct the operator for a geometry and kernel.
+     *
+     * \param threads the number of threads to use, see `util::thread_count`.
+     * Each thread keeps an image and a byte per voxel to accumulate back
+     * projections, so this defaults to a single thread.
+     */
+    block_operator(const geometry::base<D, T>& g, dim::base<D, T>& kernel,
+                   int threads = 1)
+        : g_(g), v_(kernel.get_volume()),
+          workers_(util::thread_count(threads)),
+          kernels_(util::clone_kernels(kernel, workers_)) {
+        for (int t = 0; t < workers_; ++t) {
+            buffers_.emplace_back(v_);
+            marked_.emplace_back(v_.cells());
+            touched_.emplace_back();
+        }
+    }
+
+    /** The index of the first row of projection `i`. */
+    uint64_t first_row(int i) const {
+        return i < g_.projection_count() ? (uint64_t)g_.offset(i) : g_.lines();
+    }
+
+    /** The number of rows in the block of projections [first, last). */
+    uint64_t rows(int first, int last) const {
+        return first_row(last) - first_row(first);
+    }
+
+    /** Compute the squared norm of each row of the projection matrix. */
+    std::vector<T> squared_row_norms() {
+        auto result = std::vector<T>(g_.lines());
+        for_rows_(0, g_.projection_count(),
+                  [&](int, auto& k, uint64_t row, auto line) {
+                      for (auto elem : k(line)) {
+                          result[row] += elem.value * elem.value;
+                      }
+                  });
+        return result;
+    }
+
+    /**
+     * Forward project `x` for the rows of the block [first, last). The
+     * result is stored in `y`, indexed by row relative to the block.
+     */
+    void forward(int first, int last, const image<D, T>& x, std::vector<T>& y) {
+        auto offset = first_row(first);
+        y.resize(rows(first, last));
+        for_rows_(first, last, [&](int, auto& k, uint64_t row, auto line) {
+            auto alpha = (T)0;
+            for (auto elem : k(line)) {
+                alpha += x[elem.index] * elem.value;
+            }
+            y[row - offset] = alpha;
+        });
+    }
+
+    /**
+     * Back project `y`, indexed by row relative to the block [first, last).
+     * The returned image is only nonzero on `support()`, and is valid until
+     * the next back projection.
+     */
+    const image<D, T>& back(int first, int last, const std::vector<T>& y) {
+        auto& result = buffers_[0];
+        auto& marked = marked_[0];
+        auto& support = touched_[0];
+        for (auto j : support) {
+            result[j] = (T)0;
+            marked[j] = 0;
+        }
+        support.clear();
+
+        auto offset = first_row(first);
+        for_rows_(first, last, [&](int t, auto& k, uint64_t row, auto line) {
+            auto w = y[row - offset];
+            if (w == (T)0) {
+                return;
+            }
+            for (auto elem : k(line)) {
+                if (!marked_[t][elem.index]) {
+                    marked_[t][elem.index] = 1;
+                    touched_[t].push_back(elem.index);
+                }
+                buffers_[t][elem.index] += elem.value * w;
+            }
+        });
+
+        // merge the contributions of the other threads into the first
+        for (int t = 1; t < workers_; ++t) {
+            for (auto j : touched_[t]) {
+                if (!marked[j]) {
+                    marked[j] = 1;
+                    support.push_back(j);
+                }
+                result[j] += buffers_[t][j];
+                buffers_[t][j] = (T)0;
+                marked_[t][j] = 0;
+            }
+            touched_[t].clear();
+        }
+
+        return result;
+    }
+
+    /** The voxels that may be nonzero in the last back projection. */
+    const std::vector<uint64_t>& support() const { return touched_[0]; }
+
+    /** Obtain the volume. */
+    volume<D, T> get_volume() const { return v_; }
+
+  private:
+    /**
+     * Apply `row_action(thread, kernel, row, line)` to each row of the
+     * projections [first, last). The rows are split in contiguous chunks
+     * over the threads, so that small blocks are distributed as well.
+     */
+    template <typename F>
+    void for_rows_(int first, int last, F&& row_action) {
+        auto begin = first_row(first);
+        auto end = first_row(last);
+        util::parallel_for(
+            begin, end,
+            [&](int t, uint64_t chunk_begin, uint64_t chunk_end) {
+                auto& k = *kernels_[t];
+                for (int i = first; i < last; ++i) {
+                    auto offset = first_row(i);
+                    if (first_row(i + 1) <= chunk_begin) {
+                        continue;
+                    }
+                    if (offset >= chunk_end) {
+                        break;
+                    }
+                    auto stop = g_.iter_proj(i + 1);
+                    auto it = g_.iter_proj(i);
+                    auto row = offset;
+                    // skip the rows before the chunk without computing their
+                    // lines
+                    for (; it != stop && row < chunk_begin; ++it) {
+                        ++row;
+                    }
+                    for (; it != stop && row < chunk_end; ++it, ++row) {
+                        auto[local_row, line] = *it;
+                        (void)local_row;
+                        row_action(t, k, row, line);
+                    }
+                }
+            },
+            workers_);
+    }
+
+    const geometry::base<D, T>& g_;
+    volume<D, T> v_;
+    int workers_;
+    std::vector<std::unique_ptr<dim::base<D, T>>> kernels_;
+
+    // per thread: a sparse accumulator for back projections
+    std::vector<image<D, T>> buffers_;
+    std::vector<std::vector<char>> marked_;
+    std::vector<std::vector<uint64_t>> touched_;
+};
+
+} // namespace tomo
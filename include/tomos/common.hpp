@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -11,6 +12,19 @@ using dimension = int;
 /** The default scalar type to use. */
 using default_scalar_type = double;
 
+/**
+ * The type used to index voxels and detector pixels (lines).
+ *
+ * Volumes and projection stacks can have more than 2^31 elements, so this is
+ * 64-bit by default. Define `TOMO_32BIT_INDEX` to halve the size of the
+ * matrix elements for problems that are known to be small.
+ */
+#ifdef TOMO_32BIT_INDEX
+using index_type = int32_t;
+#else
+using index_type = int64_t;
+#endif
+
 /** User defined literals for the library. */
 namespace literals {
 /** A user defined literal for dimensions. */
@@ -48,10 +48,11 @@ void communicate_overlaps(bulk::world& world,
             math::reduce<2_D>(w.max_pt - w.min_pt + math::vec2<int>{1, 1}));
 
         auto proj_size = local_geometry.projection_shape(ov.projection);
-        int idx = 0;
+        index_type idx = 0;
         for (int j = w.min_pt.y; j <= w.max_pt.y; ++j) {
             for (int i = w.min_pt.x; i <= w.max_pt.x; ++i) {
-                buffer[idx++] = proj_data[offset + i + j * proj_size[0]];
+                buffer[idx++] =
+                    proj_data[offset + i + (index_type)j * proj_size[0]];
             }
         }
 
@@ -72,10 +73,11 @@ void communicate_overlaps(bulk::world& world,
 
         auto offset = local_proj_stack.offset(proj);
         auto proj_size = local_geometry.projection_shape(proj);
-        int idx = 0;
+        index_type idx = 0;
         for (int j = w.min_pt.y; j <= w.max_pt.y; ++j) {
             for (int i = w.min_pt.x; i <= w.max_pt.x; ++i) {
-                proj_data[offset + i + j * proj_size[0]] += xs[idx++];
+                proj_data[offset + i + (index_type)j * proj_size[0]] +=
+                    xs[idx++];
             }
         }
     }
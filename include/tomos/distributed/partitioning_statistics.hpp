@@ -18,14 +18,14 @@ long long communication_volume(const geometry::base<D, T>& geometry,
     long long result = 0;
 
     auto integrator = tomo::dim::closest<D, T>(object_volume);
-    auto voxels = math::vec_to_array<D, int>(object_volume.voxels());
 
     std::set<int> owners;
     for (auto [idx, line] : geometry) {
         (void)idx;
         owners.clear();
         for (auto elem : integrator(line)) {
-            auto voxel_idx = bulk::util::unflatten<D>(voxels, elem.index);
+            auto voxel_idx =
+                math::vec_to_array<D, int>(object_volume.unroll(elem.index));
             auto owner = partitioning.owner(voxel_idx);
             owners.insert(owner);
         }
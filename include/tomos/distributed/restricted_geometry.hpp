@@ -100,7 +100,7 @@ class restricted_geometry : public geometry::base<3, T> {
     auto local_shadow(int i) const { return shadows_[i]; }
     const auto& global_geometry() const { return geometry_; }
 
-    uint64_t global_index(int projection, uint64_t local_index) {
+    index_type global_index(int projection, index_type local_index) {
         local_index -= this->offset(projection);
         int pixel_x = local_index % projection_shape(projection)[0];
         int pixel_y = local_index / projection_shape(projection)[0];
@@ -108,7 +108,8 @@ class restricted_geometry : public geometry::base<3, T> {
         int global_pixel_y = pixel_y + shadows_[projection].min_pt[1];
 
         return geometry_.offset(projection) +
-               global_pixel_y * geometry_.projection_shape(projection)[0] +
+               (index_type)global_pixel_y *
+                   geometry_.projection_shape(projection)[0] +
                global_pixel_x;
     }
 
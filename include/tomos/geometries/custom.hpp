@@ -1,5 +1,8 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "../geometry.hpp"
 
 namespace tomo {
@@ -16,7 +19,9 @@ class custom : public base<3_D, T> {
   public:
     custom(std::vector<projection<3_D, T>> projection_list)
         : base<3_D, T>(projection_list.size()),
-          projection_list_(projection_list) {}
+          projection_list_(std::move(projection_list)) {
+        this->compute_lines_();
+    }
 
     math::vec<3_D - 1, int> projection_shape(int i) const override {
         return projection_list_[i].detector_shape;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../common.hpp"
+#include "../geometry.hpp"
+#include "../math.hpp"
+#include "../volume.hpp"
+
+namespace tomo {
+namespace geometry {
+
+/**
+ * The restriction of a geometry to a region of interest. For each projection,
+ * only the smallest window of detector pixels containing every line that
+ * hits the region is kept, so that lines missing the region are never
+ * traced.
+ *
+ * Unlike `distributed::restricted_geometry`, which projects the corners of
+ * the region onto the detector of a trajectory, this decides for each line
+ * whether it hits the region, and therefore works for any geometry,
+ * including parallel ones.
+ *
+ * \tparam D the dimension of the volume.
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class roi : public base<D, T> {
+  public:
+    /**
+     * Restrict the geometry `g` to the lines hitting `region`. The geometry
+     * `g` should outlive the restriction.
+     */
+    roi(const base<D, T>& g, const volume<D, T>& region)
+        : base<D, T>(g.projection_count(), g.parallel()), g_(g),
+          region_(region) {
+        auto none = math::vec<D - 1, int>(std::numeric_limits<int>::max());
+        first_.resize(g.projection_count(), none);
+        last_.resize(g.projection_count(), math::vec<D - 1, int>(-1));
+
+        for (int i = 0; i < g.projection_count(); ++i) {
+            auto shape = g.projection_shape(i);
+            auto stop = g.iter_proj(i + 1);
+            for (auto it = g.iter_proj(i); it != stop; ++it) {
+                auto[local_row, line] = *it;
+                if (!math::aabb_intersection<D, T>(
+                        line.source, line.detector, region.physical_lengths(),
+                        region.origin())) {
+                    continue;
+                }
+                auto pixel = unroll_(local_row, shape);
+                first_[i] = math::min(first_[i], pixel);
+                last_[i] = math::max(last_[i], pixel);
+            }
+        }
+
+        this->compute_lines_();
+    }
+
+    math::vec<D - 1, int> projection_shape(int i) const override {
+        if (empty_(i)) {
+            return math::vec<D - 1, int>(0);
+        }
+        return last_[i] - first_[i] + math::vec<D - 1, int>(1);
+    }
+
+    math::vec<D, T> detector_corner(int i) const override {
+        return g_.detector_corner(i) + shift_(i);
+    }
+
+    math::vec<D, T> source_location(int i) const override {
+        // parallel lines are offset from the source location, and should
+        // move along with the window
+        if (this->parallel()) {
+            return g_.source_location(i) + shift_(i);
+        }
+        return g_.source_location(i);
+    }
+
+    std::array<math::vec<D, T>, D - 1> projection_delta(int i) const override {
+        return g_.projection_delta(i);
+    }
+
+    projection<D, T> get_projection(int i) const override {
+        auto result = g_.get_projection(i);
+        auto shape = projection_shape(i);
+        auto delta = g_.projection_delta(i);
+        result.detector_location = detector_corner(i);
+        for (int d = 0; d < D - 1; ++d) {
+            result.detector_location += ((T)0.5 * shape[d]) * delta[d];
+            result.detector_size[d] = shape[d] * math::norm<D, T>(delta[d]);
+        }
+        result.detector_shape = shape;
+        return result;
+    }
+
+    /** Obtain the line of the full geometry corresponding to a line. */
+    uint64_t global_line(int i, uint64_t local_row) const {
+        auto pixel = unroll_(local_row, projection_shape(i)) + first_[i];
+        auto shape = g_.projection_shape(i);
+        uint64_t row = 0;
+        for (int d = D - 2; d >= 0; --d) {
+            row = row * shape[d] + pixel[d];
+        }
+        return g_.offset(i) + row;
+    }
+
+    /** Obtain the full geometry. */
+    const base<D, T>& full_geometry() const { return g_; }
+
+    /** Obtain the region of interest. */
+    const volume<D, T>& region() const { return region_; }
+
+  private:
+    bool empty_(int i) const { return last_[i][0] < first_[i][0]; }
+
+    math::vec<D, T> shift_(int i) const {
+        auto result = math::vec<D, T>((T)0);
+        if (empty_(i)) {
+            return result;
+        }
+        auto delta = g_.projection_delta(i);
+        for (int d = 0; d < D - 1; ++d) {
+            result += (T)first_[i][d] * delta[d];
+        }
+        return result;
+    }
+
+    // the pixel of a line in a projection, the first axis runs fastest
+    static math::vec<D - 1, int> unroll_(uint64_t row,
+                                         math::vec<D - 1, int> shape) {
+        math::vec<D - 1, int> pixel;
+        for (int d = 0; d < D - 1; ++d) {
+            pixel[d] = (int)(row % shape[d]);
+            row /= shape[d];
+        }
+        return pixel;
+    }
+
+    const base<D, T>& g_;
+    volume<D, T> region_;
+    std::vector<math::vec<D - 1, int>> first_;
+    std::vector<math::vec<D - 1, int>> last_;
+};
+
+} // namespace geometry
+} // namespace tomo
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -255,12 +256,13 @@ class base {
 
     virtual std::array<math::vec<D, T>, D - 1>
     projection_delta(int i) const = 0;
-    int offset(int idx) const { return offsets_[idx]; }
+    /** Obtain the index of the first line of projection `idx`. */
+    index_type offset(int idx) const { return offsets_[idx]; }
 
     virtual projection<D, T> get_projection(int idx) const = 0;
 
   protected:
-    std::vector<int> offsets_;
+    std::vector<index_type> offsets_;
 
     void compute_offsets_() {
         offsets_.resize(projection_count());
@@ -285,5 +287,60 @@ class base {
     bool parallel_ = false;
 };
 
+/**
+ * Call `f(line_number, line)` for each line of the geometry, ordered by the
+ * last detector axis first, and by projection second. For the usual
+ * trajectories around the last axis of the volume, consecutive lines then
+ * pass through the same slab of the volume, which keeps the access to the
+ * voxels close to sequential.
+ */
+template <dimension D, typename T, typename F>
+void for_each_line_by_rows(const base<D, T>& g, F&& f) {
+    if constexpr (D == 2) {
+        for (auto[line_number, line] : g) {
+            f(line_number, line);
+        }
+        return;
+    }
+
+    auto rows = 0;
+    for (int i = 0; i < g.projection_count(); ++i) {
+        rows = std::max(rows, g.projection_shape(i)[D - 2]);
+    }
+
+    for (int row = 0; row < rows; ++row) {
+        for (int i = 0; i < g.projection_count(); ++i) {
+            auto shape = g.projection_shape(i);
+            if (row >= shape[D - 2]) {
+                continue;
+            }
+            auto corner = g.detector_corner(i);
+            auto source = g.source_location(i);
+            auto delta = g.projection_delta(i);
+
+            // the lines of this row, the first detector axis runs fastest
+            auto row_size = 1;
+            for (int d = 0; d < D - 2; ++d) {
+                row_size *= shape[d];
+            }
+            uint64_t line_number = g.offset(i) + (uint64_t)row * row_size;
+            for (int k = 0; k < row_size; ++k, ++line_number) {
+                auto location = corner + ((T)row + (T)0.5) * delta[D - 2];
+                auto rest = k;
+                for (int d = 0; d < D - 2; ++d) {
+                    location += ((T)(rest % shape[d]) + (T)0.5) * delta[d];
+                    rest /= shape[d];
+                }
+                if (g.parallel()) {
+                    f(line_number, math::ray<D, T>{source + location - corner,
+                                                   location});
+                } else {
+                    f(line_number, math::ray<D, T>{source, location});
+                }
+            }
+        }
+    }
+}
+
 } // namespace geometry
 } // namespace tomo
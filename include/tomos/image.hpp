@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <stddef.h>
 #include <type_traits>
 #include <vector>
@@ -29,6 +30,22 @@ class image {
     /** Construct a image for a given volume with a constant value. */
     image(volume<D, T> v, T value) : v_(v), data_(v.cells(), value) {}
 
+    /** Construct an image by evaluating an expression, see `img::operator+`. */
+    template <typename E, typename = typename E::expression_type>
+    image(const E& expr) : image(expr.container().get_volume()) {
+        *this = expr;
+    }
+
+    /** Evaluate an element-wise expression into the image, in one pass. */
+    template <typename E, typename = typename E::expression_type>
+    image& operator=(const E& expr) {
+        assert(expr.size() == data_.size());
+        for (uint64_t i = 0; i < data_.size(); ++i) {
+            data_[i] = expr[i];
+        }
+        return *this;
+    }
+
     /** Obtain the index of an image voxel within the volume. */
     size_t index(math::vec<D, int> xs) const { return v_.index(xs); }
 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "image.hpp"
+#include "projections.hpp"
+#include "projector.hpp"
+#include "volume.hpp"
+
+namespace tomo {
+
+class mapped_file_error : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * An image whose voxels are stored in a memory-mapped file, instead of in
+ * memory. This allows for volumes that are larger than the available memory,
+ * in which case the operating system pages voxels in and out as they are
+ * accessed.
+ *
+ * The voxels are stored as raw values of type T, in the order of the volume
+ * (the first axis runs fastest). Traversals should access the voxels in
+ * slabs along the last axis to keep paging sequential, see
+ * `forward_projection` and `back_projection` for mapped images.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T = default_scalar_type>
+class mapped_image {
+  public:
+    using value_type = T;
+
+    /**
+     * Map the file at `path` as an image on `v`. If the file does not exist,
+     * it is created and zero-initialized. An existing file is not resized,
+     * and a `mapped_file_error` is thrown if its size does not match.
+     *
+     * \param keep whether to keep the file after the image is destroyed
+     * \param header the number of bytes in the file before the voxels, e.g.
+     * for a `.npy` file, see `util/npy.hpp`
+     */
+    mapped_image(volume<D, T> v, std::string path, bool keep = true,
+                 uint64_t header = 0)
+        : v_(v), path_(path), keep_(keep), size_(v.cells()), header_(header) {
+        // only a file that is created here is sized, an existing file has to
+        // match the layout
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        auto created = fd_ >= 0;
+        if (!created && errno == EEXIST) {
+            fd_ = ::open(path.c_str(), O_RDWR);
+        }
+        if (fd_ < 0) {
+            throw mapped_file_error("could not open '" + path + "'");
+        }
+
+        auto bytes = header_ + size_ * sizeof(T);
+        if (created) {
+            if (::ftruncate(fd_, bytes) != 0) {
+                ::close(fd_);
+                throw mapped_file_error("could not resize '" + path + "'");
+            }
+        } else {
+            struct stat status;
+            if (::fstat(fd_, &status) != 0 ||
+                (uint64_t)status.st_size != bytes) {
+                ::close(fd_);
+                throw mapped_file_error("size mismatch for '" + path + "'");
+            }
+        }
+
+        auto address =
+            ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd_);
+            throw mapped_file_error("could not map '" + path + "'");
+        }
+        base_ = static_cast<char*>(address);
+        data_ = reinterpret_cast<T*>(base_ + header_);
+    }
+
+    mapped_image(const mapped_image&) = delete;
+    mapped_image& operator=(const mapped_image&) = delete;
+
+    mapped_image(mapped_image&& other)
+        : v_(other.v_), path_(other.path_), keep_(other.keep_),
+          size_(other.size_), header_(other.header_), fd_(other.fd_),
+          base_(other.base_), data_(other.data_) {
+        other.fd_ = -1;
+        other.base_ = nullptr;
+        other.data_ = nullptr;
+    }
+
+    ~mapped_image() {
+        if (base_) {
+            ::munmap(base_, header_ + size_ * sizeof(T));
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            if (!keep_) {
+                ::unlink(path_.c_str());
+            }
+        }
+    }
+
+    /** Obtain the index of an image voxel within the volume. */
+    size_t index(math::vec<D, int> xs) const { return v_.index(xs); }
+
+    /** Obtain the value for an image voxel. */
+    T& operator[](size_t index) { return data_[index]; }
+    const T& operator[](size_t index) const { return data_[index]; }
+
+    T& operator()(math::vec<D, int> xs) { return (*this)[index(xs)]; }
+    const T& operator()(math::vec<D, int> xs) const {
+        return (*this)[index(xs)];
+    }
+
+    /** The number of voxels. */
+    uint64_t size() const { return size_; }
+
+    /** Obtain a pointer to the mapped voxels. */
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+    /** Obtain the volume. */
+    volume<D, T> get_volume() const { return v_; }
+
+    /** Obtain the path of the mapped file. */
+    const std::string& path() const { return path_; }
+
+    /** Clear the image. Fills each voxel with zero. */
+    void clear() { std::fill(data_, data_ + size_, (T)0); }
+
+    /** Copy an in-memory image into the mapped image. */
+    void assign(const image<D, T>& x) {
+        std::copy(x.data().begin(), x.data().end(), data_);
+    }
+
+    /** Copy the mapped image into memory. */
+    image<D, T> load() const {
+        auto result = image<D, T>(v_);
+        std::copy(data_, data_ + size_, result.mutable_data().begin());
+        return result;
+    }
+
+    /** Write the modified voxels to the file. */
+    void flush() { ::msync(base_, header_ + size_ * sizeof(T), MS_SYNC); }
+
+    /**
+     * Hint that the voxels [first, last) are not needed for a while, so that
+     * their pages can be evicted. Modified voxels are kept in the file.
+     */
+    void release(uint64_t first, uint64_t last) {
+        auto page = (uint64_t)::sysconf(_SC_PAGESIZE);
+        auto begin = (header_ + first * sizeof(T) + page - 1) / page * page;
+        auto end = (header_ + last * sizeof(T)) / page * page;
+        if (begin < end) {
+            ::madvise(base_ + begin, end - begin, MADV_DONTNEED);
+        }
+    }
+
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+
+  private:
+    volume<D, T> v_;
+    std::string path_;
+    bool keep_;
+    uint64_t size_;
+    uint64_t header_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    T* data_ = nullptr;
+};
+
+/**
+ * Perform a forward-projection of a mapped image. The lines are visited
+ * by detector row, see `geometry::for_each_line_by_rows`, so that the voxels
+ * are paged in slab by slab.
+ */
+template <dimension D, typename T>
+void forward_projection(const mapped_image<D, T>& f,
+                        const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                        projections<D, T>& sino) {
+    sino.clear();
+    geometry::for_each_line_by_rows(g, [&](uint64_t line_number, auto line) {
+        auto value = (T)0;
+        for (auto elem : proj(line)) {
+            value += f[elem.index] * elem.value;
+        }
+        sino[line_number] = value;
+    });
+}
+
+/**
+ * Perform a back-projection into a mapped image, visiting the lines by
+ * detector row, see `forward_projection`. The image is overwritten.
+ */
+template <dimension D, typename T>
+void back_projection(const projections<D, T>& sino,
+                     const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                     mapped_image<D, T>& f) {
+    f.clear();
+    geometry::for_each_line_by_rows(g, [&](uint64_t line_number, auto line) {
+        auto weight = sino[line_number];
+        for (auto elem : proj(line)) {
+            f[elem.index] += weight * elem.value;
+        }
+    });
+}
+
+} // namespace tomo
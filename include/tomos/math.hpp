@@ -48,7 +48,7 @@ namespace math {
 template <typename T = default_scalar_type>
 struct matrix_element {
     /// The column index.
-    int index;
+    index_type index;
 
     /// The value of the matrix element.
     T value;
@@ -401,7 +401,7 @@ void interpolate(vec<D, T> a, volume<D, T> v,
             continue;
         }
 
-        int index = v.index_by_vector(cell);
+        auto index = v.index_by_vector(cell);
         auto value = product<D, T>(vec<D, T>((T)1) - abs(a - cell_center));
         queue.push_back({index, value});
     }
@@ -2,6 +2,10 @@
 
 #include "constants.hpp"
 #include "vector.hpp"
+#include "../util/parallel.hpp"
+
+#include <array>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -117,10 +121,10 @@ auto sum(vec<D, T> vec) {
     return result;
 }
 
-/** Multiply the elements of a vector together */
+/** Multiply the elements of a vector together, e.g. to count voxels. */
 template <dimension D>
-int reduce(vec<D, int> vec) {
-    int product = 1;
+index_type reduce(vec<D, int> vec) {
+    index_type product = 1;
     for (int d = 0; d < D; ++d) {
         product *= vec[d];
     }
@@ -137,24 +141,116 @@ T norm(vec<D, T> vec) {
     return sqrt(squared_sum);
 }
 
+namespace detail {
+
+/** The number of terms that are summed directly, without compensation. */
+constexpr std::size_t reduction_block = 512;
+
+/**
+ * The minimum number of terms per thread for a sum that is distributed over
+ * threads. The threads are created for each sum, so smaller sums are
+ * computed serially.
+ */
+constexpr std::size_t parallel_reduction_threshold = 1 << 20;
+
+/** The maximum number of threads used for a sum. */
+constexpr int max_reduction_threads = 64;
+
+/** Add `value` to `sum`, using Kahan's compensated summation. */
+template <typename T>
+void kahan_add(T& sum, T& compensation, T value) {
+    auto y = value - compensation;
+    auto t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+}
+
+/**
+ * Sum `term(i)` for i in [begin, end). Each block of terms is summed using
+ * independent accumulators, which allows the compiler to vectorize the
+ * loop, and the block sums are then added with compensated summation.
+ */
+template <typename T, typename F>
+T compensated_sum(std::size_t begin, std::size_t end, const F& term) {
+    constexpr std::size_t lanes = 8;
+    T sum = (T)0;
+    T compensation = (T)0;
+    for (auto b = begin; b < end; b += reduction_block) {
+        auto block_end = std::min(b + reduction_block, end);
+        std::array<T, lanes> partial = {};
+        auto i = b;
+        for (; i + lanes <= block_end; i += lanes) {
+            for (std::size_t l = 0; l < lanes; ++l) {
+                partial[l] += term(i + l);
+            }
+        }
+        for (; i < block_end; ++i) {
+            partial[0] += term(i);
+        }
+        // add the accumulators pairwise
+        for (auto width = lanes / 2; width > 0; width /= 2) {
+            for (std::size_t l = 0; l < width; ++l) {
+                partial[l] += partial[l + width];
+            }
+        }
+        kahan_add(sum, compensation, partial[0]);
+    }
+    return sum;
+}
+
+/**
+ * Sum `term(i)` for i in [0, size). Large sums are distributed over threads,
+ * each summing at least `parallel_reduction_threshold` terms, and the result
+ * only depends on the size and the number of hardware threads.
+ */
+template <typename T, typename F>
+T reduce_sum(std::size_t size, const F& term) {
+    auto threads = (int)std::min<std::size_t>(
+        std::min(util::thread_count(), max_reduction_threads),
+        size / parallel_reduction_threshold);
+    if (threads < 2) {
+        return compensated_sum<T>(0, size, term);
+    }
+
+    std::array<T, max_reduction_threads> partial = {};
+    auto blocks = (size + reduction_block - 1) / reduction_block;
+    util::parallel_for(
+        (std::size_t)0, blocks,
+        [&](int t, std::size_t begin, std::size_t end) {
+            partial[t] = compensated_sum<T>(
+                begin * reduction_block,
+                std::min(end * reduction_block, size), term);
+        },
+        threads);
+
+    T sum = (T)0;
+    T compensation = (T)0;
+    for (int t = 0; t < threads; ++t) {
+        kahan_add(sum, compensation, partial[t]);
+    }
+    return sum;
+}
+
+} // namespace detail
+
+/**
+ * Compute the Euclidean norm of an image, projections, or other vector-like
+ * object. Large vectors are reduced in parallel, using compensated
+ * summation to remain accurate in single precision.
+ */
 template <typename VecLike>
-typename VecLike::value_type norm(VecLike x) {
+typename VecLike::value_type norm(const VecLike& x) {
     using T = typename VecLike::value_type;
-    T result = (T)0;
-    for (auto i = 0u; i < x.size(); ++i) {
-        result += x[i] * x[i];
-    }
-    return sqrt(result);
+    return sqrt(detail::reduce_sum<T>(
+        x.size(), [&](std::size_t i) { return x[i] * x[i]; }));
 }
 
+/** Compute the inner product of two vector-like objects, see `norm`. */
 template <typename VecLike>
-typename VecLike::value_type dot(VecLike x, VecLike y) {
+typename VecLike::value_type dot(const VecLike& x, const VecLike& y) {
     using T = typename VecLike::value_type;
-    T result = (T)0;
-    for (auto i = 0u; i < x.size(); ++i) {
-        result += x[i] * y[i];
-    }
-    return result;
+    return detail::reduce_sum<T>(
+        x.size(), [&](std::size_t i) { return x[i] * y[i]; });
 }
 
 
@@ -162,7 +258,7 @@ template <typename VecLike>
 typename VecLike::value_type min_value(VecLike x) {
     using T = typename VecLike::value_type;
     T result = std::numeric_limits<T>::max();
-    for (auto i = 0u; i < x.size(); ++i) {
+    for (uint64_t i = 0; i < x.size(); ++i) {
         result = min<T>(x[i], result);
     }
     return result;
@@ -172,7 +268,7 @@ template <typename VecLike>
 typename VecLike::value_type max_value(VecLike x) {
     using T = typename VecLike::value_type;
     T result = std::numeric_limits<T>::min();
-    for (auto i = 0u; i < x.size(); ++i) {
+    for (uint64_t i = 0; i < x.size(); ++i) {
         result = max<T>(x[i], result);
     }
     return result;
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "image.hpp"
+#include "projections.hpp"
+#include "projector.hpp"
+#include "volume.hpp"
+
+namespace tomo {
+
+/**
+ * A number of images (channels) on the same volume, e.g. energy channels or
+ * repeated scans.
+ *
+ * The channels are stored interleaved, i.e. the values of all channels of a
+ * voxel are contiguous. This way, a single traversal of the geometry updates
+ * every channel for each matrix element.
+ *
+ * \tparam D the dimension of the volume (and thus the reconstruction problem).
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T = default_scalar_type>
+class multi_image {
+  public:
+    using value_type = T;
+
+    /** Construct a zero-initialized image with `channels` channels. */
+    multi_image(volume<D, T> v, int channels)
+        : v_(v), channels_(channels), data_(v.cells() * channels) {}
+
+    /** Construct a multi-channel image from a set of images. */
+    multi_image(const std::vector<image<D, T>>& images)
+        : multi_image(images.at(0).get_volume(), (int)images.size()) {
+        for (int c = 0; c < channels_; ++c) {
+            set_channel(c, images[c]);
+        }
+    }
+
+    /** Obtain the number of channels. */
+    int channels() const { return channels_; }
+
+    /** Obtain a pointer to the values of all channels of a voxel. */
+    T* voxel(size_t index) { return &data_[index * channels_]; }
+    const T* voxel(size_t index) const { return &data_[index * channels_]; }
+
+    /** Obtain the value of a voxel in a given channel. */
+    T& operator()(size_t index, int channel) {
+        return data_[index * channels_ + channel];
+    }
+    const T& operator()(size_t index, int channel) const {
+        return data_[index * channels_ + channel];
+    }
+
+    /** Obtain the i-th value of the (interleaved) underlying data. */
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    /** Obtain a single channel as an image. */
+    image<D, T> channel(int c) const {
+        auto result = image<D, T>(v_);
+        for (uint64_t j = 0; j < v_.cells(); ++j) {
+            result[j] = (*this)(j, c);
+        }
+        return result;
+    }
+
+    /** Set a single channel from an image. */
+    void set_channel(int c, const image<D, T>& img) {
+        assert(img.size() == v_.cells());
+        for (uint64_t j = 0; j < v_.cells(); ++j) {
+            (*this)(j, c) = img[j];
+        }
+    }
+
+    /** The total number of values, i.e. voxels times channels. */
+    auto size() const { return data_.size(); }
+
+    /** Obtain a reference to the underlying image data. */
+    std::vector<T>& mutable_data() { return data_; }
+    const std::vector<T>& data() const { return data_; }
+
+    /** Obtain the volume. */
+    volume<D, T> get_volume() const { return v_; }
+
+    /** Clear the image. Fills each voxel with zero. */
+    void clear() { std::fill(data_.begin(), data_.end(), 0); }
+
+    auto begin() { return data_.begin(); }
+    auto end() { return data_.end(); }
+
+  private:
+    volume<D, T> v_;
+    int channels_;
+    std::vector<T> data_;
+};
+
+/**
+ * A number of projection stacks (channels) for the same geometry, stored
+ * interleaved, see `multi_image`.
+ *
+ * \tparam D the dimension of the volume (and thus the reconstruction problem).
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T = default_scalar_type>
+class multi_projections {
+  public:
+    using value_type = T;
+
+    /** Construct zero-initialized projections with `channels` channels. */
+    multi_projections(const geometry::base<D, T>& geometry, int channels)
+        : geometry_(geometry), channels_(channels),
+          data_(geometry.lines() * channels) {}
+
+    /** Construct multi-channel projections from a set of projections. */
+    multi_projections(const geometry::base<D, T>& geometry,
+                      const std::vector<projections<D, T>>& stacks)
+        : multi_projections(geometry, (int)stacks.size()) {
+        for (int c = 0; c < channels_; ++c) {
+            set_channel(c, stacks[c]);
+        }
+    }
+
+    /** Obtain the number of channels. */
+    int channels() const { return channels_; }
+
+    /** Obtain a pointer to the measurements of all channels of a line. */
+    T* line(size_t index) { return &data_[index * channels_]; }
+    const T* line(size_t index) const { return &data_[index * channels_]; }
+
+    /** Obtain the measurement of a line in a given channel. */
+    T& operator()(size_t index, int channel) {
+        return data_[index * channels_ + channel];
+    }
+    const T& operator()(size_t index, int channel) const {
+        return data_[index * channels_ + channel];
+    }
+
+    /** Obtain the i-th value of the (interleaved) underlying data. */
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    /** Obtain a single channel as a projection stack. */
+    projections<D, T> channel(int c) const {
+        auto result = projections<D, T>(geometry_);
+        for (uint64_t i = 0; i < geometry_.lines(); ++i) {
+            result[i] = (*this)(i, c);
+        }
+        return result;
+    }
+
+    /** Set a single channel from a projection stack. */
+    void set_channel(int c, const projections<D, T>& stack) {
+        assert(stack.size() == geometry_.lines());
+        for (uint64_t i = 0; i < geometry_.lines(); ++i) {
+            (*this)(i, c) = stack[i];
+        }
+    }
+
+    /** The total number of values, i.e. lines times channels. */
+    auto size() const { return data_.size(); }
+
+    /** Obtain a reference to the underlying projection data. */
+    std::vector<T>& mutable_data() { return data_; }
+    const std::vector<T>& data() const { return data_; }
+
+    /** Obtain the geometry. */
+    const geometry::base<D, T>& get_geometry() const { return geometry_; }
+
+    /** Clear the projections. Sets each measurement to zero. */
+    void clear() { std::fill(data_.begin(), data_.end(), 0); }
+
+    auto begin() { return data_.begin(); }
+    auto end() { return data_.end(); }
+
+  private:
+    const geometry::base<D, T>& geometry_;
+    int channels_;
+    std::vector<T> data_;
+};
+
+namespace math {
+
+/** Compute the squared norm of each channel. */
+template <typename MultiLike>
+std::vector<typename MultiLike::value_type>
+channel_squared_norms(const MultiLike& x) {
+    using T = typename MultiLike::value_type;
+    auto k = x.channels();
+    auto result = std::vector<T>(k);
+    for (uint64_t i = 0; i < x.size(); i += k) {
+        for (int c = 0; c < k; ++c) {
+            result[c] += x[i + c] * x[i + c];
+        }
+    }
+    return result;
+}
+
+} // namespace math
+
+/**
+ * Perform a forward-projection of each channel of the image at once, into
+ * existing projections with the same number of channels. The projections
+ * are overwritten.
+ */
+template <dimension D, typename T>
+void forward_projection(const multi_image<D, T>& f,
+                        const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                        multi_projections<D, T>& sino) {
+    auto k = f.channels();
+    sino.clear();
+
+    for (auto[line_number, line] : g) {
+        auto out = sino.line(line_number);
+        for (auto elem : proj(line)) {
+            auto in = f.voxel(elem.index);
+            for (int c = 0; c < k; ++c) {
+                out[c] += in[c] * elem.value;
+            }
+        }
+    }
+}
+
+/** Perform a forward-projection of each channel of the image at once. */
+template <dimension D, typename T>
+multi_projections<D, T> forward_projection(const multi_image<D, T>& f,
+                                           const geometry::base<D, T>& g,
+                                           dim::base<D, T>& proj) {
+    auto sino = multi_projections<D, T>(g, f.channels());
+    forward_projection(f, g, proj, sino);
+    return sino;
+}
+
+/**
+ * Perform a back-projection of each channel of the projections at once,
+ * into an existing image with the same number of channels. The image is
+ * overwritten.
+ */
+template <dimension D, typename T>
+void back_projection(const multi_projections<D, T>& sino,
+                     const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                     multi_image<D, T>& f) {
+    auto k = sino.channels();
+    f.clear();
+
+    for (auto[line_number, line] : g) {
+        auto in = sino.line(line_number);
+        for (auto elem : proj(line)) {
+            auto out = f.voxel(elem.index);
+            for (int c = 0; c < k; ++c) {
+                out[c] += in[c] * elem.value;
+            }
+        }
+    }
+}
+
+/** Perform a back-projection of each channel of the projections at once. */
+template <dimension D, typename T>
+multi_image<D, T> back_projection(const multi_projections<D, T>& sino,
+                                  const geometry::base<D, T>& g,
+                                  dim::base<D, T>& proj, volume<D, T> v) {
+    auto f = multi_image<D, T>(v, sino.channels());
+    back_projection(sino, g, proj, f);
+    return f;
+}
+
+} // namespace tomo
@@ -11,6 +11,22 @@
 
 namespace tomo {
 
+/**
+ * Perform a forward-projection of a given image into existing projections,
+ * so that no memory is allocated. The projections are overwritten.
+ */
+template <dimension D, typename T>
+void forward_projection(const tomo::image<D, T>& f,
+                        const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                        projections<D, T>& sino) {
+    sino.clear();
+    for (auto[line_number, line] : g) {
+        for (auto elem : proj(line)) {
+            sino[line_number] += f[elem.index] * elem.value;
+        }
+    }
+}
+
 /**
  * Perform a forward-projection of a given image.
  * */
@@ -19,14 +35,24 @@ projections<D, T> forward_projection(const tomo::image<D, T>& f,
                                      const geometry::base<D, T>& g,
                                      dim::base<D, T>& proj) {
     auto sino = projections<D, T>(g);
+    forward_projection(f, g, proj, sino);
+    return sino;
+}
 
+/**
+ * Perform a back-projection of the given projections into an existing
+ * image, so that no memory is allocated. The image is overwritten.
+ */
+template <dimension D, typename T>
+void back_projection(const projections<D, T>& sino,
+                     const geometry::base<D, T>& g, dim::base<D, T>& proj,
+                     image<D, T>& f) {
+    f.clear();
     for (auto[line_number, line] : g) {
         for (auto elem : proj(line)) {
-            sino[line_number] += f[elem.index] * elem.value;
+            f[elem.index] += sino[line_number] * elem.value;
         }
     }
-
-    return sino;
 }
 
 /** Perform a back-projection of the given projections. */
@@ -35,13 +61,7 @@ image<D, T> back_projection(const projections<D, T>& sino,
                             const geometry::base<D, T>& g,
                             dim::base<D, T>& proj, volume<D, T> v) {
     auto f = image<D, T>(v);
-
-    for (auto[line_number, line] : g) {
-        for (auto elem : proj(line)) {
-            f[elem.index] += sino[line_number] * elem.value;
-        }
-    }
-
+    back_projection(sino, g, proj, f);
     return f;
 }
 
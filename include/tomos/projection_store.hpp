@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "image.hpp"
+#include "math.hpp"
+#include "projections.hpp"
+
+namespace tomo {
+
+class projection_store_error : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * Measurements for a geometry that are stored in a file, and read in chunks
+ * of consecutive projections. Only a bounded window of chunks is kept in
+ * memory, so that projection stacks larger than the available memory can be
+ * used for reconstruction, see e.g. the `sirt` and `os_sirt` overloads in
+ * `algorithms/streamed.hpp`.
+ *
+ * The file contains the raw measurements of type T, in the order of the lines
+ * of the geometry, i.e. the same layout as `projections::data`. Chunks can be
+ * prefetched in the background while the previous chunk is being processed.
+ * To keep the chunk that is being processed resident, obtain it with `chunk`
+ * before prefetching the next one. Chunks that are still being read are
+ * never evicted, so the window can be exceeded briefly.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T = default_scalar_type>
+class projection_store {
+  public:
+    using value_type = T;
+    using chunk_type = std::shared_ptr<const std::vector<T>>;
+
+    /**
+     * Store the measurements for `g` in the file at `path`. If the file does
+     * not exist, it is created and zero-initialized. An existing file is not
+     * resized, and a `projection_store_error` is thrown if its size does not
+     * match.
+     *
+     * \param chunk_projections the number of projections in each chunk
+     * \param window the maximum number of chunks that are kept in memory
+     * \param header the number of bytes in the file before the measurements,
+     * e.g. for a `.npy` file, see `util/npy.hpp`
+     */
+    projection_store(const geometry::base<D, T>& g, std::string path,
+                     int chunk_projections, int window = 2,
+                     uint64_t header = 0)
+        : geometry_(g), path_(path),
+          chunk_projections_(std::max(chunk_projections, 1)),
+          window_(std::max(window, 1)), header_(header) {
+        // only a file that is created here is sized, an existing file has to
+        // match the layout
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        auto created = fd_ >= 0;
+        if (!created && errno == EEXIST) {
+            fd_ = ::open(path.c_str(), O_RDWR);
+        }
+        if (fd_ < 0) {
+            throw projection_store_error("could not open '" + path + "'");
+        }
+
+        auto bytes = header_ + g.lines() * sizeof(T);
+        if (created) {
+            if (::ftruncate(fd_, bytes) != 0) {
+                ::close(fd_);
+                throw projection_store_error("could not resize '" + path + "'");
+            }
+        } else {
+            struct stat status;
+            if (::fstat(fd_, &status) != 0 ||
+                (uint64_t)status.st_size != bytes) {
+                ::close(fd_);
+                throw projection_store_error("size mismatch for '" + path + "'");
+            }
+        }
+    }
+
+    projection_store(const projection_store&) = delete;
+    projection_store& operator=(const projection_store&) = delete;
+
+    ~projection_store() {
+        // pending reads use the file, so wait for them first
+        resident_.clear();
+        ::close(fd_);
+    }
+
+    /** The number of chunks. */
+    int chunks() const {
+        return (geometry_.projection_count() + chunk_projections_ - 1) /
+               chunk_projections_;
+    }
+
+    /** The first projection of chunk `c`. */
+    int first_projection(int c) const { return c * chunk_projections_; }
+
+    /** The projection after the last projection of chunk `c`. */
+    int last_projection(int c) const {
+        return std::min((c + 1) * chunk_projections_,
+                        geometry_.projection_count());
+    }
+
+    /** The first line of chunk `c`. */
+    uint64_t first_line(int c) const {
+        return geometry_.offset(first_projection(c));
+    }
+
+    /** The number of lines in chunk `c`. */
+    uint64_t chunk_lines(int c) const {
+        auto last = last_projection(c);
+        auto end = last < geometry_.projection_count() ? geometry_.offset(last)
+                                                       : geometry_.lines();
+        return end - first_line(c);
+    }
+
+    /**
+     * Obtain the measurements of chunk `c`, reading them if they are not in
+     * memory yet. The chunk stays valid while it is held, also after it has
+     * been evicted from the window.
+     */
+    chunk_type chunk(int c) {
+        std::shared_future<chunk_type> pending;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            pending = request_(c, std::launch::deferred);
+        }
+        return pending.get();
+    }
+
+    /** Start reading chunk `c` in the background. */
+    void prefetch(int c) {
+        if (c < 0 || c >= chunks()) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mutex_);
+        request_(c, std::launch::async);
+    }
+
+    /** Write the measurements of chunk `c`. */
+    void write(int c, const std::vector<T>& values) {
+        if (values.size() != chunk_lines(c)) {
+            throw projection_store_error("chunk size mismatch");
+        }
+        write_(first_line(c), values.data(), values.size());
+        std::lock_guard<std::mutex> guard(mutex_);
+        resident_.erase(c);
+        lru_.remove(c);
+    }
+
+    /** Write the measurements of projection `i`. */
+    void set_projection(int i, const image<D - 1, T>& img) {
+        auto pixels = math::reduce<D - 1>(geometry_.projection_shape(i));
+        if (img.size() != (uint64_t)pixels) {
+            throw projection_store_error("projection size mismatch");
+        }
+        write_(geometry_.offset(i), img.data().data(), pixels);
+        auto c = i / chunk_projections_;
+        std::lock_guard<std::mutex> guard(mutex_);
+        resident_.erase(c);
+        lru_.remove(c);
+    }
+
+    /** Write all measurements. */
+    void assign(const projections<D, T>& p) {
+        for (int c = 0; c < chunks(); ++c) {
+            auto first = p.data().begin() + first_line(c);
+            write(c, std::vector<T>(first, first + chunk_lines(c)));
+        }
+    }
+
+    /** Read all measurements into memory. */
+    projections<D, T> load() {
+        auto result = projections<D, T>(geometry_);
+        for (int c = 0; c < chunks(); ++c) {
+            auto values = chunk(c);
+            std::copy(values->begin(), values->end(),
+                      result.mutable_data().begin() + first_line(c));
+        }
+        return result;
+    }
+
+    /** The number of chunk reads from the file so far. */
+    int reads() const { return reads_; }
+
+    /** The number of chunks currently in memory (or being read). */
+    int resident() const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return (int)resident_.size();
+    }
+
+    /** Obtain the geometry of the projections. */
+    const geometry::base<D, T>& get_geometry() const { return geometry_; }
+
+    /** Obtain the path of the file. */
+    const std::string& path() const { return path_; }
+
+  private:
+    std::shared_future<chunk_type> request_(int c, std::launch policy) {
+        lru_.remove(c);
+        lru_.push_back(c);
+
+        auto it = resident_.find(c);
+        if (it != resident_.end()) {
+            return it->second;
+        }
+
+        auto first = first_line(c);
+        auto count = chunk_lines(c);
+        auto pending = std::shared_future<chunk_type>(
+            std::async(policy, [this, first, count] {
+                ++reads_;
+                auto values = std::make_shared<std::vector<T>>(count);
+                read_(first, values->data(), count);
+                return chunk_type(values);
+            }));
+        resident_[c] = pending;
+
+        // evict the least recently used chunks, but not the ones that are
+        // still being read, since destroying those would block
+        for (auto it = lru_.begin();
+             (int)resident_.size() > window_ && it != lru_.end();) {
+            auto& candidate = resident_[*it];
+            if (*it != c && candidate.wait_for(std::chrono::seconds(0)) !=
+                                std::future_status::timeout) {
+                resident_.erase(*it);
+                it = lru_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return pending;
+    }
+
+    void read_(uint64_t first, T* values, uint64_t count) const {
+        auto bytes = count * sizeof(T);
+        auto offset = header_ + first * sizeof(T);
+        auto buffer = reinterpret_cast<char*>(values);
+        while (bytes > 0) {
+            auto n = ::pread(fd_, buffer, bytes, offset);
+            if (n <= 0) {
+                throw projection_store_error("could not read '" + path_ + "'");
+            }
+            buffer += n;
+            offset += n;
+            bytes -= n;
+        }
+    }
+
+    void write_(uint64_t first, const T* values, uint64_t count) {
+        auto bytes = count * sizeof(T);
+        auto offset = header_ + first * sizeof(T);
+        auto buffer = reinterpret_cast<const char*>(values);
+        while (bytes > 0) {
+            auto n = ::pwrite(fd_, buffer, bytes, offset);
+            if (n <= 0) {
+                throw projection_store_error("could not write '" + path_ +
+                                             "'");
+            }
+            buffer += n;
+            offset += n;
+            bytes -= n;
+        }
+    }
+
+    const geometry::base<D, T>& geometry_;
+    std::string path_;
+    int chunk_projections_;
+    int window_;
+    uint64_t header_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::map<int, std::shared_future<chunk_type>> resident_;
+    std::list<int> lru_;
+    std::atomic<int> reads_{0};
+};
+
+} // namespace tomo
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <numeric>
 #include <vector>
 
@@ -36,13 +37,29 @@ class projections {
     projections(projections<D, T>&& other)
         : geometry_(other.geometry_), data_(std::move(other.data_)) {}
 
+    /** Construct projections by evaluating an element-wise expression. */
+    template <typename E, typename = typename E::expression_type>
+    projections(const E& expr) : projections(expr.container().get_geometry()) {
+        *this = expr;
+    }
+
+    /** Evaluate an element-wise expression into the projections. */
+    template <typename E, typename = typename E::expression_type>
+    projections& operator=(const E& expr) {
+        assert(expr.size() == data_.size());
+        for (uint64_t i = 0; i < data_.size(); ++i) {
+            data_[i] = expr[i];
+        }
+        return *this;
+    }
+
     /**
      * Obtain a reference to the i-th measurement, corresponding to the i-th
      * line.
      * \param i the index of the line
      */
-    T& operator[](int i) { return data_[i]; }
-    const T& operator[](int i) const { return data_[i]; }
+    T& operator[](index_type i) { return data_[i]; }
+    const T& operator[](index_type i) const { return data_[i]; }
 
     /**
      * Obtain a reference to the underlying projection data.
@@ -58,7 +75,7 @@ class projections {
         auto offset = this->offset(idx);
         auto shape = geometry_.projection_shape(idx);
         auto img = image<D - 1, T>(volume<D - 1, T>(shape));
-        for (int i = 0; i < math::reduce<D - 1>(shape); ++i) {
+        for (index_type i = 0; i < math::reduce<D - 1>(shape); ++i) {
             img[i] = data_[offset + i];
         }
         return img;
@@ -68,12 +85,15 @@ class projections {
     void set_projection(int idx, const image<D - 1, T>& img) {
         auto offset = this->offset(idx);
         auto pixels = math::reduce<D - 1>(geometry_.projection_shape(idx));
-        for (int i = 0; i < pixels; ++i) {
+        for (index_type i = 0; i < pixels; ++i) {
             data_[offset + i] = img[i];
         }
     }
 
-    int offset(int idx) const { return geometry_.offset(idx); }
+    index_type offset(int idx) const { return geometry_.offset(idx); }
+
+    /** Obtain the geometry of the projections. */
+    const geometry::base<D, T>& get_geometry() const { return geometry_; }
 
     auto size() const { return geometry_.lines(); }
 
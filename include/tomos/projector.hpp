@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <type_traits>
 #include <vector>
 
@@ -7,6 +9,7 @@
 #include "geometry.hpp"
 #include "logging.hpp"
 #include "math.hpp"
+#include "voxel_mask.hpp"
 
 namespace tomo {
 namespace dim {
@@ -51,10 +54,34 @@ class base {
 
             this->reset_(line);
             this->line_ = line;
+
+            if (mask_) {
+                auto& mask = *mask_;
+                queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                                            [&](const auto& elem) {
+                                                return !mask.active(elem.index);
+                                            }),
+                             queue_.end());
+            }
         }
         return *this;
     }
 
+    /**
+     * Skip the inactive voxels of a mask, e.g. outside the field of view.
+     * Masked voxels are then never updated by the algorithms. The mask is not
+     * owned, and should outlive the DIM. Pass `nullptr` to remove the mask.
+     *
+     * The mask only filters the matrix elements of a line after it has been
+     * traced, so it does not reduce the tracing work. It does reduce the
+     * work of the algorithms on the elements, and `column` skips inactive
+     * voxels entirely.
+     */
+    void set_mask(const voxel_mask<D, T>* mask) { mask_ = mask; }
+
+    /** Obtain the mask of the DIM, if any. */
+    const voxel_mask<D, T>* get_mask() const { return mask_; }
+
     /** Obtain the current line of the DIM. */
     math::line<D, T> get_line() const { return line_; }
 
@@ -63,11 +90,19 @@ class base {
 
     virtual T matrix_value(math::ray<D, T> ray, math::vec<D, int> voxel) = 0;
 
+    /**
+     * Obtain an independent copy of the DIM. A DIM keeps the matrix elements
+     * of the current line as state, so concurrent traversals each require
+     * their own copy.
+     */
+    virtual std::unique_ptr<base<D, T>> clone() const = 0;
+
   protected:
     volume<D, T> volume_;
     math::line<D, T> line_;
 
     std::vector<math::matrix_element<T>> queue_;
+    const voxel_mask<D, T>* mask_ = nullptr;
 
   private:
     void clear_() { this->queue_.clear(); }
@@ -21,6 +21,10 @@ class closest : public base<D, T> {
     }
 
 
+    std::unique_ptr<base<D, T>> clone() const override {
+        return std::make_unique<closest<D, T>>(*this);
+    }
+
     T matrix_value(math::ray<D, T> ray, math::vec<D, int> voxel) {
         (void)ray;
         (void)voxel;
@@ -38,7 +42,7 @@ class closest : public base<D, T> {
             auto index = (uint64_t)this->volume_.index(
                 math::vec<D, int>(current_point));
             if (index >= 0 && index < this->volume_.cells()) {
-                this->queue_.push_back({(int)index, (T)1.0});
+                this->queue_.push_back({(index_type)index, (T)1.0});
             }
             current_point += line.delta;
         }
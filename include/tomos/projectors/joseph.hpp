@@ -21,6 +21,10 @@ class joseph : public base<D, T> {
         this->queue_.reserve((int)(2 * max_width));
     }
 
+    std::unique_ptr<base<D, T>> clone() const override {
+        return std::make_unique<joseph<D, T>>(*this);
+    }
+
     T matrix_value(math::ray<D, T> ray, math::vec<D, int> voxel) override {
         auto truncated_line = math::truncate_to_volume(ray, this->volume_);
         if (!truncated_line) {
@@ -107,8 +111,8 @@ class joseph : public base<D, T> {
                 auto slice_index = slice_volume.unroll(this->queue_[i].index);
                 auto extended_slice_index =
                     math::extend<D, int>(slice_index, axis, current_row);
-                int voxel_index = this->volume_.index(extended_slice_index);
-                this->queue_[i].index = voxel_index;
+                this->queue_[i].index =
+                    this->volume_.index(extended_slice_index);
             }
 
             current_point += step;
@@ -22,6 +22,10 @@ class linear : public base<D, T> {
         this->queue_.reserve((int)(math::sqrt<T>(D) * math::pow(D, 2) * max_width));
     }
 
+    std::unique_ptr<base<D, T>> clone() const override {
+        return std::make_unique<linear<D, T>>(*this);
+    }
+
     T matrix_value(math::ray<D, T> ray, math::vec<D, int> voxel) {
         (void)ray;
         (void)voxel;
@@ -23,30 +23,49 @@
  * SOFTWARE.
  */
 
+#include "block_operator.hpp"
 #include "common.hpp"
 #include "geometry.hpp"
 #include "image.hpp"
 #include "logging.hpp"
+#include "mapped_image.hpp"
 #include "math.hpp"
+#include "multichannel.hpp"
 #include "operations.hpp"
 #include "phantoms.hpp"
+#include "projection_store.hpp"
 #include "projector.hpp"
 #include "projections.hpp"
 #include "utilities.hpp"
 #include "volume.hpp"
+#include "voxel_mask.hpp"
 
 #include "util/bench.hpp"
+#include "util/checkpoint.hpp"
+#include "util/flat_field.hpp"
+#include "util/geometry_file.hpp"
+#include "util/npy.hpp"
+#include "util/projection_feed.hpp"
+#include "util/snapshot.hpp"
 #include "util/report.hpp"
 #include "util/tomo_args.hpp"
+#include "util/volume_writer.hpp"
 #include "util/read_metadata.hpp"
 #include "util/read_tiff.hpp"
 #include "util/image_processing.hpp"
 #include "util/trees.hpp"
 
+#include "algorithms/accelerated.hpp"
 #include "algorithms/art.hpp"
 #include "algorithms/sart.hpp"
 #include "algorithms/sirt.hpp"
 #include "algorithms/cgls.hpp"
+#include "algorithms/ordered_subsets.hpp"
+#include "algorithms/pipelined.hpp"
+#include "algorithms/plan.hpp"
+#include "algorithms/roi.hpp"
+#include "algorithms/stopping_criterion.hpp"
+#include "algorithms/streamed.hpp"
 
 #include "distributed/recursive_bisectioning.hpp"
 #include "distributed/trivial_partitioning.hpp"
@@ -62,6 +81,7 @@
 #include "geometries/laminography.hpp"
 #include "geometries/list.hpp"
 #include "geometries/parallel.hpp"
+#include "geometries/roi.hpp"
 #include "geometries/tomosynthesis.hpp"
 #include "geometries/trajectory.hpp"
 
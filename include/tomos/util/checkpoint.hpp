@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tomo {
+
+class invalid_checkpoint_error : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * The state of an iterative algorithm, as stored in a checkpoint: the last
+ * completed iteration, and the vectors (image, search directions, residuals,
+ * ...) that the algorithm needs to continue.
+ */
+template <typename T>
+struct checkpoint_state {
+    std::string algorithm;
+    int iteration = -1;
+    std::vector<std::vector<T>> vectors;
+};
+
+/**
+ * Periodically writes the state of an iterative algorithm to a file, so that
+ * an interrupted reconstruction can be resumed.
+ *
+ * Saving only copies the state into a buffer, the file is written by a
+ * background thread. If the previous state is still being written, the
+ * pending state is replaced by the newer one, so that the iteration loop is
+ * never stalled by the disk. The file is replaced atomically, i.e. it always
+ * contains a complete checkpoint.
+ *
+ * The file contains a small header, followed by the raw vectors:
+ *
+ *     "TOMOCKPT" | version | sizeof(T) | algorithm | iteration | vectors
+ *
+ * where each string and vector is preceded by its length as a 64-bit
+ * integer.
+ *
+ * \tparam T the scalar type of the algorithm
+ */
+template <typename T>
+class checkpoint {
+  public:
+    /**
+     * Checkpoint to the file at `path`, every `interval` iterations.
+     *
+     * \param resume whether an algorithm using this checkpoint should
+     * continue from the state stored in `path`, if it exists.
+     */
+    checkpoint(std::string path, int interval = 1, bool resume = false)
+        : path_(path), interval_(std::max(interval, 1)), resume_(resume) {}
+
+    checkpoint(const checkpoint&) = delete;
+    checkpoint& operator=(const checkpoint&) = delete;
+
+    ~checkpoint() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        wake_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+    }
+
+    /** Whether the state after `iteration` should be saved. */
+    bool due(int iteration) const { return (iteration + 1) % interval_ == 0; }
+
+    /**
+     * Save the state of `algorithm` after `iteration`. The vectors are copied,
+     * and can be modified as soon as this returns.
+     */
+    void save(const std::string& algorithm, int iteration,
+              std::initializer_list<const std::vector<T>*> vectors) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pending_.algorithm = algorithm;
+            pending_.iteration = iteration;
+            pending_.vectors.resize(vectors.size());
+            auto i = 0u;
+            for (auto v : vectors) {
+                pending_.vectors[i++].assign(v->begin(), v->end());
+            }
+            has_pending_ = true;
+            if (!writer_.joinable()) {
+                writer_ = std::thread([this] { write_loop_(); });
+            }
+        }
+        wake_.notify_all();
+    }
+
+    /** Block until every saved state has been written. */
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return !has_pending_ && !writing_; });
+        if (!error_.empty()) {
+            throw invalid_checkpoint_error(error_);
+        }
+    }
+
+    /**
+     * Obtain the state to resume `algorithm` from. This is empty if the
+     * checkpoint was not constructed for resuming, or if no file exists yet.
+     *
+     * \param sizes the expected size of each stored vector
+     *
+     * \throws invalid_checkpoint_error if the file does not hold a checkpoint
+     * of `algorithm` with vectors of the expected sizes.
+     */
+    std::optional<checkpoint_state<T>>
+    restore(const std::string& algorithm, std::vector<size_t> sizes) const {
+        if (!resume_) {
+            return {};
+        }
+        auto state = load(path_);
+        if (!state) {
+            return {};
+        }
+        if (state->algorithm != algorithm) {
+            throw invalid_checkpoint_error("checkpoint '" + path_ +
+                                           "' was written by '" +
+                                           state->algorithm + "', not '" +
+                                           algorithm + "'");
+        }
+        if (state->vectors.size() != sizes.size()) {
+            throw invalid_checkpoint_error("checkpoint '" + path_ +
+                                           "' has an unexpected layout");
+        }
+        for (auto i = 0u; i < sizes.size(); ++i) {
+            if (state->vectors[i].size() != sizes[i]) {
+                throw invalid_checkpoint_error(
+                    "checkpoint '" + path_ +
+                    "' does not match the volume or geometry");
+            }
+        }
+        return state;
+    }
+
+    /**
+     * Read the checkpoint stored in `path`, or nothing if it does not exist.
+     *
+     * \throws invalid_checkpoint_error if the file is not a valid checkpoint
+     */
+    static std::optional<checkpoint_state<T>> load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) {
+            return {};
+        }
+        auto file_size = (uint64_t)in.tellg();
+        in.seekg(0);
+
+        auto fail = [&](std::string reason) {
+            throw invalid_checkpoint_error("checkpoint '" + path + "' " +
+                                           reason);
+        };
+
+        char magic[8];
+        in.read(magic, 8);
+        if (!in || std::memcmp(magic, magic_, 8) != 0) {
+            fail("is not a checkpoint");
+        }
+        if (read_<uint32_t>(in) != version_) {
+            fail("has an unsupported version");
+        }
+        if (read_<uint32_t>(in) != sizeof(T)) {
+            fail("has a different scalar type");
+        }
+
+        // lengths are checked against the file size, so that a corrupt
+        // file does not lead to huge allocations
+        auto length = [&](uint64_t element_size) {
+            auto n = read_<uint64_t>(in);
+            if (!in || n > file_size / element_size) {
+                fail("is truncated");
+            }
+            return n;
+        };
+
+        checkpoint_state<T> state;
+        state.algorithm.resize(length(1));
+        in.read(&state.algorithm[0], state.algorithm.size());
+        state.iteration = (int)read_<int64_t>(in);
+        state.vectors.resize(length(sizeof(uint64_t)));
+        for (auto& v : state.vectors) {
+            v.resize(length(sizeof(T)));
+            in.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(T));
+        }
+        if (!in) {
+            fail("is truncated");
+        }
+
+        return state;
+    }
+
+    /** Obtain the path of the checkpoint file. */
+    const std::string& path() const { return path_; }
+
+  private:
+    void write_loop_() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return has_pending_ || done_; });
+            if (!has_pending_) {
+                break;
+            }
+
+            // swap the buffers, so that new states can be saved while writing
+            std::swap(pending_, current_);
+            has_pending_ = false;
+            writing_ = true;
+            lock.unlock();
+            auto error = write_(current_);
+            lock.lock();
+            writing_ = false;
+            if (!error.empty()) {
+                error_ = error;
+            }
+            idle_.notify_all();
+        }
+    }
+
+    std::string write_(const checkpoint_state<T>& state) const {
+        auto tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(magic_, 8);
+            write_value_(out, version_);
+            write_value_(out, (uint32_t)sizeof(T));
+            write_value_(out, (uint64_t)state.algorithm.size());
+            out.write(state.algorithm.data(), state.algorithm.size());
+            write_value_(out, (int64_t)state.iteration);
+            write_value_(out, (uint64_t)state.vectors.size());
+            for (auto& v : state.vectors) {
+                write_value_(out, (uint64_t)v.size());
+                out.write(reinterpret_cast<const char*>(v.data()),
+                          v.size() * sizeof(T));
+            }
+            if (!out) {
+                return "could not write checkpoint '" + tmp + "'";
+            }
+        }
+        if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+            return "could not replace checkpoint '" + path_ + "'";
+        }
+        return {};
+    }
+
+    template <typename S>
+    static void write_value_(std::ofstream& out, S value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(S));
+    }
+
+    template <typename S>
+    static S read_(std::ifstream& in) {
+        S value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(S));
+        return value;
+    }
+
+    static constexpr const char* magic_ = "TOMOCKPT";
+    static constexpr uint32_t version_ = 1;
+
+    std::string path_;
+    int interval_;
+    bool resume_;
+
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    checkpoint_state<T> pending_;
+    checkpoint_state<T> current_;
+    bool has_pending_ = false;
+    bool writing_ = false;
+    bool done_ = false;
+    std::string error_;
+};
+
+} // namespace tomo
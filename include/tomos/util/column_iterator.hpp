@@ -1,41 +1,71 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <limits>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 #include "../geometry.hpp"
+#include "../image.hpp"
 #include "../math/geometric.hpp"
 #include "../projector.hpp"
+#include "parallel.hpp"
 
 namespace tomo {
 
+/**
+ * Generates the columns of the projection matrix, i.e. the lines that
+ * intersect a voxel together with the matrix elements. If the kernel has a
+ * mask, see `dim::base::set_mask`, the columns of inactive voxels are empty.
+ *
+ * The data of each projection that is needed to cast the shadow of a voxel
+ * is obtained from the geometry once, on construction.
+ */
 template <dimension D, typename T>
 class column {
   public:
     column(const geometry::base<D, T>& geometry, dim::base<D, T>& kernel)
-        : geometry_(geometry), kernel_(kernel), volume_(kernel_.get_volume()) {}
+        : geometry_(geometry), kernel_(kernel), volume_(kernel_.get_volume()) {
+        for (int p = 0; p < geometry_.projection_count(); ++p) {
+            projections_.push_back({geometry_.get_projection(p),
+                                    geometry_.detector_corner(p),
+                                    geometry_.source_location(p),
+                                    geometry_.projection_delta(p),
+                                    geometry_.projection_shape(p),
+                                    geometry_.offset(p)});
+        }
+    }
 
     const auto& operator()(math::vec<D, int> voxel) {
         using pix_iter = typename geometry::base<D, T>::pixel_iterator;
 
         values_.clear();
 
+        auto mask = kernel_.get_mask();
+        if (mask && !mask->active(volume_.index(voxel))) {
+            return *this;
+        }
+
         // get corners of detector pixels
         auto corners = corners_(voxel);
 
         // project voxel to detector for each projection
         for (int p = 0; p < geometry_.projection_count(); ++p) {
+            const auto& data = projections_[p];
+
             // if parallel/cone...
             auto shade = shadow_(corners, p);
 
             auto shape = math::vec<D - 1, int>(0);
-            auto corner = geometry_.detector_corner(p);
+            auto corner = data.detector_corner;
             for (int d = 0; d < D - 1; ++d) {
                 shape[d] = shade[d][1] - shade[d][0] + 1;
-                corner += (T)shade[d][0] * geometry_.projection_delta(p)[d];
+                corner += (T)shade[d][0] * data.projection_delta[d];
             }
-            auto location = geometry_.source_location(p);
-            auto delta = geometry_.projection_delta(p);
+            auto location = data.source_location;
+            auto delta = data.projection_delta;
             auto parallel = geometry_.parallel();
 
             //            std::cout << "Projection: \n"
@@ -57,8 +87,8 @@ class column {
                 pix_iter(shape, corner, location, delta, parallel);
 
             // iterate over all these lines
-            auto detels = math::product<D - 1, int>(shape);
-            for (int i = 0; i < detels; ++i) {
+            auto detels = math::reduce<D - 1>(shape);
+            for (index_type i = 0; i < detels; ++i) {
                 auto x = i;
                 math::vec<D - 1, int> idx;
                 for (int d = 0; d < D - 1; ++d) {
@@ -66,13 +96,13 @@ class column {
                     idx[d] += shade[d][0];
                     x /= shape[d];
                 }
-                int line_idx = idx[0];
-                int offset = 1;
+                index_type line_idx = idx[0];
+                index_type offset = 1;
                 for (int d = 1; d < D - 1; ++d) {
-                    offset *= geometry_.projection_shape(p)[d];
+                    offset *= data.projection_shape[d];
                     line_idx += offset * idx[d];
                 }
-                line_idx += geometry_.offset(p);
+                line_idx += data.offset;
 
                 auto ray = *detel_iterator;
                 // for each line, compute the matrix element
@@ -87,6 +117,10 @@ class column {
     auto begin() const { return values_.begin(); }
     auto end() const { return values_.end(); }
 
+    /** The matrix elements of the current column, as a contiguous array. */
+    const std::tuple<uint64_t, T>* data() const { return values_.data(); }
+    auto size() const { return values_.size(); }
+
   private:
     auto corners_(math::vec<D, int> voxel) {
         const auto O = volume_.origin();
@@ -108,7 +142,7 @@ class column {
 
         for (auto x : corners) {
             math::vec<D - 1, int> hyxel =
-                cast_shadow_(x, geometry_.get_projection(p));
+                cast_shadow_(x, projections_[p].projection);
             for (int d = 0; d < D - 1; ++d) {
                 result[d][0] = math::min(result[d][0], hyxel[d]);
                 result[d][1] = math::max(result[d][1], hyxel[d]);
@@ -116,7 +150,7 @@ class column {
         }
         for (int d = 0; d < D - 1; ++d) {
             result[d][0] = math::max(0, result[d][0] - 1);
-            result[d][1] = math::min(geometry_.projection_shape(p)[d] - 1,
+            result[d][1] = math::min(projections_[p].projection_shape[d] - 1,
                                      result[d][1] + 1);
         }
 
@@ -124,7 +158,7 @@ class column {
     }
 
     math::vec<D - 1, int> cast_shadow_(math::vec<D, T> x,
-                                       geometry::projection<D, T> proj) {
+                                       const geometry::projection<D, T>& proj) {
         if (proj.parallel) {
             return math::parallel_project_hyxel(x, proj);
         } else {
@@ -132,11 +166,161 @@ class column {
         }
     }
 
+    struct projection_data {
+        geometry::projection<D, T> projection;
+        math::vec<D, T> detector_corner;
+        math::vec<D, T> source_location;
+        std::array<math::vec<D, T>, D - 1> projection_delta;
+        math::vec<D - 1, int> projection_shape;
+        index_type offset;
+    };
+
     const geometry::base<D, T>& geometry_;
     dim::base<D, T>& kernel_;
     tomo::volume<D, T> volume_;
+    std::vector<projection_data> projections_;
 
     std::vector<std::tuple<uint64_t, T>> values_;
 };
 
+/** The default amount of memory used for caching columns, in bytes. */
+constexpr std::size_t default_column_cache_bytes = (std::size_t)1 << 30;
+
+/**
+ * A cache of the columns of the projection matrix, stored voxel-major in a
+ * compressed format.
+ *
+ * The columns are built in slabs of consecutive voxels, distributed over
+ * threads. Voxels are cached in order until the memory budget is exhausted,
+ * the columns of the remaining voxels are recomputed on request. The squared
+ * norms of all columns are computed while building.
+ *
+ * After construction the cache is immutable, and can be shared by threads.
+ */
+template <dimension D, typename T>
+class column_cache {
+  public:
+    using entry = std::tuple<uint64_t, T>;
+
+    /** A contiguous range of matrix elements, forming a column. */
+    struct range {
+        const entry* first;
+        const entry* last;
+
+        const entry* begin() const { return first; }
+        const entry* end() const { return last; }
+        auto size() const { return last - first; }
+    };
+
+    /**
+     * Build the cache.
+     *
+     * \param memory_budget the maximum number of bytes for the stored columns
+     * \param threads the number of threads used for building
+     */
+    column_cache(const geometry::base<D, T>& g, dim::base<D, T>& kernel,
+                 std::size_t memory_budget = default_column_cache_bytes,
+                 int threads = 0)
+        : v_(kernel.get_volume()), norms_(v_) {
+        auto workers = util::thread_count(threads);
+        auto kernels = std::vector<std::unique_ptr<dim::base<D, T>>>();
+        auto columns = std::vector<column<D, T>>();
+        columns.reserve(workers);
+        for (int t = 0; t < workers; ++t) {
+            kernels.push_back(kernel.clone());
+            columns.emplace_back(g, *kernels.back());
+        }
+
+        auto max_entries = memory_budget / sizeof(entry);
+        auto slab = std::max<uint64_t>(1024, v_.cells() / (16 * workers));
+        auto local = std::vector<std::vector<entry>>(workers);
+        auto counts = std::vector<std::vector<uint64_t>>(workers);
+
+        starts_.push_back(0);
+        bool caching = true;
+        for (uint64_t begin = 0; begin < v_.cells(); begin += slab) {
+            auto end = std::min(begin + slab, v_.cells());
+            util::parallel_for(
+                begin, end,
+                [&](int t, uint64_t first, uint64_t last) {
+                    local[t].clear();
+                    counts[t].clear();
+                    for (auto j = first; j < last; ++j) {
+                        auto& col = columns[t];
+                        col(v_.unroll(j));
+                        auto norm = (T)0;
+                        for (auto[line_idx, value] : col) {
+                            (void)line_idx;
+                            norm += value * value;
+                        }
+                        norms_[j] = norm;
+                        if (caching) {
+                            local[t].insert(local[t].end(), col.begin(),
+                                            col.end());
+                            counts[t].push_back(col.size());
+                        }
+                    }
+                },
+                workers);
+
+            if (!caching) {
+                continue;
+            }
+
+            auto slab_entries = (std::size_t)0;
+            for (auto& l : local) {
+                slab_entries += l.size();
+            }
+            if (entries_.size() + slab_entries > max_entries) {
+                caching = false;
+                continue;
+            }
+
+            // grow geometrically, but never beyond the budget
+            if (entries_.size() + slab_entries > entries_.capacity()) {
+                entries_.reserve(std::min<std::size_t>(
+                    max_entries, std::max(2 * entries_.capacity(),
+                                          entries_.size() + slab_entries)));
+            }
+
+            // the chunks of the threads are in voxel order
+            for (int t = 0; t < workers; ++t) {
+                entries_.insert(entries_.end(), local[t].begin(),
+                                local[t].end());
+                for (auto count : counts[t]) {
+                    starts_.push_back(starts_.back() + count);
+                }
+                local[t].clear();
+                counts[t].clear();
+            }
+        }
+        entries_.shrink_to_fit();
+    }
+
+    /** The number of voxels, starting from the first, that are cached. */
+    uint64_t cached_voxels() const { return starts_.size() - 1; }
+
+    /**
+     * Obtain the column of voxel `j`. If the voxel is not cached, the column
+     * is computed with `col`, and the range is valid until its next use.
+     */
+    range operator()(uint64_t j, column<D, T>& col) const {
+        if (j < cached_voxels()) {
+            return {entries_.data() + starts_[j],
+                    entries_.data() + starts_[j + 1]};
+        }
+        col(v_.unroll(j));
+        return {col.data(), col.data() + col.size()};
+    }
+
+    /** The squared norms of the columns. */
+    const image<D, T>& squared_norms() const { return norms_; }
+
+  private:
+    volume<D, T> v_;
+    image<D, T> norms_;
+    std::vector<uint64_t> starts_;
+    std::vector<entry> entries_;
+};
+
 } // namespace tomo
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../common.hpp"
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../math.hpp"
+#include "../projections.hpp"
+#include "../volume.hpp"
+#include "parallel.hpp"
+
+namespace tomo {
+
+class invalid_reference_frames : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * Flat and dark-field correction of raw detector frames, followed by the
+ * log-transform, i.e. each pixel is replaced by:
+ *
+ * \f[ -\log\left(\frac{I - I_d}{I_f - I_d}\right), \f]
+ *
+ * where \f$I_f\f$ and \f$I_d\f$ are the averages of the flat and dark fields.
+ * The transmission (the fraction) is clamped to `[min_transmission,
+ * max_transmission]` first, so that dead or hot pixels do not produce
+ * infinities or large outliers. Pixels where the flat field does not exceed
+ * the dark field are set to zero.
+ *
+ * The correction works in place, either on a single projection (e.g. while
+ * it is being loaded) or on all projections, distributed over threads. The
+ * inner loops are branch-free over contiguous pixels, so that they can be
+ * vectorized by the compiler.
+ *
+ * \tparam D the dimension of the volume, the frames have dimension D - 1
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class flat_field_correction {
+  public:
+    /**
+     * Construct the correction from (one or more) flat and dark fields,
+     * which are averaged.
+     */
+    flat_field_correction(const std::vector<image<D - 1, T>>& flats,
+                          const std::vector<image<D - 1, T>>& darks,
+                          T min_transmission = (T)1e-6,
+                          T max_transmission = (T)2)
+        : min_(min_transmission), max_(max_transmission) {
+        if (flats.empty()) {
+            throw invalid_reference_frames("no flat fields given");
+        }
+        shape_ = flats[0].get_volume().voxels();
+
+        auto flat = average_(flats);
+        dark_ = darks.empty() ? std::vector<T>(flat.size(), (T)0)
+                              : average_(darks);
+        scale_.resize(flat.size());
+        for (uint64_t j = 0; j < flat.size(); ++j) {
+            auto range = flat[j] - dark_[j];
+            scale_[j] = range > (T)0 ? (T)1 / range : (T)0;
+        }
+    }
+
+    /**
+     * Correct the pixels of a single projection in place. The projection
+     * should have the shape of the frames, see `check`.
+     */
+    void operator()(T* pixels) const {
+        const auto n = scale_.size();
+        const auto* dark = dark_.data();
+        const auto* scale = scale_.data();
+
+        for (uint64_t j = 0; j < n; ++j) {
+            auto t = (pixels[j] - dark[j]) * scale[j];
+            pixels[j] = std::min(std::max(t, min_), max_);
+        }
+        for (uint64_t j = 0; j < n; ++j) {
+            pixels[j] = -std::log(pixels[j]);
+        }
+        // pixels without a valid flat field carry no information
+        for (uint64_t j = 0; j < n; ++j) {
+            pixels[j] = scale[j] > (T)0 ? pixels[j] : (T)0;
+        }
+    }
+
+    /** Correct a single projection in place. */
+    void operator()(image<D - 1, T>& projection) const {
+        check_(projection.get_volume().voxels());
+        (*this)(projection.mutable_data().data());
+    }
+
+    /**
+     * Correct all projections in place, distributed over `threads` threads
+     * (defaults to all).
+     */
+    void operator()(projections<D, T>& p, int threads = 0) const {
+        auto& g = p.get_geometry();
+        check(g, g.projection_count());
+        auto data = p.mutable_data().data();
+        util::parallel_for(
+            0, g.projection_count(),
+            [&](int, int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    (*this)(data + g.offset(i));
+                }
+            },
+            threads);
+    }
+
+    /**
+     * Check that the first `count` projections of `g` have the shape of the
+     * frames, and throw `invalid_reference_frames` otherwise.
+     */
+    void check(const geometry::base<D, T>& g, int count) const {
+        for (int i = 0; i < count; ++i) {
+            check_(g.projection_shape(i));
+        }
+    }
+
+    /** The shape of the frames. */
+    math::vec<D - 1, int> shape() const { return shape_; }
+
+  private:
+    std::vector<T> average_(const std::vector<image<D - 1, T>>& frames) {
+        auto result = std::vector<T>(frames[0].size(), (T)0);
+        for (auto& frame : frames) {
+            check_(frame.get_volume().voxels());
+            for (uint64_t j = 0; j < result.size(); ++j) {
+                result[j] += frame[j];
+            }
+        }
+        for (auto& x : result) {
+            x /= (T)frames.size();
+        }
+        return result;
+    }
+
+    void check_(math::vec<D - 1, int> shape) const {
+        if (shape != shape_) {
+            throw invalid_reference_frames(
+                "frame shape does not match the reference frames");
+        }
+    }
+
+    math::vec<D - 1, int> shape_;
+    std::vector<T> dark_;
+    std::vector<T> scale_;
+    T min_;
+    T max_;
+};
+
+} // namespace tomo
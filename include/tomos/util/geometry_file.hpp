@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common.hpp"
+#include "../geometries/custom.hpp"
+#include "../geometry.hpp"
+#include "../math.hpp"
+
+namespace tomo {
+
+class invalid_geometry_file : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * Compact geometry files, for trajectories with many arbitrary projections.
+ *
+ * Each projection is described by 12 numbers, in the layout of the
+ * `cone_vec` geometry of the ASTRA toolbox:
+ *
+ *     source (3) | detector center (3) | u (3) | v (3)
+ *
+ * where u and v are the vectors from one detector pixel to the next along
+ * the columns and rows. All vectors are in the coordinates of the volume.
+ *
+ * The binary format consists of a 32 byte header, followed by the vectors of
+ * each projection as 64-bit floats:
+ *
+ *     "TOMOGEOM" | version (u32) | 0 (u32) | projections (u64)
+ *                | columns (i32) | rows (i32) | vectors
+ *
+ * The binary file is mapped rather than parsed, so that reading it takes a
+ * single pass over the vectors.
+ */
+namespace geometry_file {
+
+constexpr uint32_t version = 1;
+constexpr uint64_t header_size = 32;
+constexpr int vector_size = 12;
+
+/** Obtain a projection from its 12 vectors, see `geometry_file`. */
+template <typename T>
+geometry::projection<3_D, T> to_projection(const double* vectors,
+                                           math::vec<2_D, int> shape) {
+    auto vec = [&](int k) {
+        return math::vec<3_D, T>{(T)vectors[3 * k], (T)vectors[3 * k + 1],
+                                 (T)vectors[3 * k + 2]};
+    };
+
+    auto result = geometry::projection<3_D, T>{};
+    result.source_location = vec(0);
+    result.detector_location = vec(1);
+    result.detector_shape = shape;
+    result.parallel = false;
+    for (int d = 0; d < 2; ++d) {
+        auto delta = vec(2 + d);
+        auto length = math::norm<3_D, T>(delta);
+        if (length <= (T)0) {
+            throw invalid_geometry_file("detector pixels of zero size");
+        }
+        result.detector_tilt[d] = delta / length;
+        result.detector_size[d] = shape[d] * length;
+    }
+    return result;
+}
+
+/** Obtain the 12 vectors describing projection `i` of a geometry. */
+template <typename T>
+std::vector<double> to_vectors(const geometry::base<3_D, T>& g, int i) {
+    auto shape = g.projection_shape(i);
+    auto delta = g.projection_delta(i);
+    auto center = g.detector_corner(i) + ((T)0.5 * shape[0]) * delta[0] +
+                  ((T)0.5 * shape[1]) * delta[1];
+
+    auto result = std::vector<double>();
+    for (auto x : {g.source_location(i), center, delta[0], delta[1]}) {
+        for (int d = 0; d < 3; ++d) {
+            result.push_back(x[d]);
+        }
+    }
+    return result;
+}
+
+} // namespace geometry_file
+
+/**
+ * Read a binary geometry file, see `geometry_file`, as a custom geometry.
+ */
+template <typename T>
+std::unique_ptr<geometry::custom<T>> read_geometry_file(std::string path) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw invalid_geometry_file("could not open '" + path + "'");
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 ||
+        (uint64_t)status.st_size < geometry_file::header_size) {
+        ::close(fd);
+        throw invalid_geometry_file("not a geometry file: '" + path + "'");
+    }
+    auto bytes = (uint64_t)status.st_size;
+    auto address = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw invalid_geometry_file("could not map '" + path + "'");
+    }
+    auto base = static_cast<const char*>(address);
+
+    uint32_t version = 0;
+    uint64_t count = 0;
+    int32_t shape[2] = {0, 0};
+    std::memcpy(&version, base + 8, sizeof(version));
+    std::memcpy(&count, base + 16, sizeof(count));
+    std::memcpy(shape, base + 24, sizeof(shape));
+
+    auto expected = geometry_file::header_size +
+                    count * geometry_file::vector_size * sizeof(double);
+    if (std::memcmp(base, "TOMOGEOM", 8) != 0 ||
+        version != geometry_file::version || bytes != expected ||
+        shape[0] <= 0 || shape[1] <= 0) {
+        ::munmap(address, bytes);
+        throw invalid_geometry_file("invalid geometry file: '" + path + "'");
+    }
+
+    auto vectors =
+        reinterpret_cast<const double*>(base + geometry_file::header_size);
+    auto projections = std::vector<geometry::projection<3_D, T>>();
+    projections.reserve(count);
+    try {
+        for (uint64_t i = 0; i < count; ++i) {
+            projections.push_back(geometry_file::to_projection<T>(
+                vectors + i * geometry_file::vector_size,
+                {shape[0], shape[1]}));
+        }
+    } catch (...) {
+        ::munmap(address, bytes);
+        throw;
+    }
+    ::munmap(address, bytes);
+
+    return std::make_unique<geometry::custom<T>>(std::move(projections));
+}
+
+/**
+ * Write a (cone-beam) geometry as a binary geometry file, see
+ * `geometry_file`. Every projection should have the same shape.
+ */
+template <typename T>
+void write_geometry_file(const geometry::base<3_D, T>& g, std::string path) {
+    if (g.parallel()) {
+        throw invalid_geometry_file("parallel geometries are not supported");
+    }
+    auto shape = g.projection_shape(0);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uint32_t version = geometry_file::version;
+    uint32_t reserved = 0;
+    uint64_t count = g.projection_count();
+    int32_t columns = shape[0];
+    int32_t rows = shape[1];
+    out.write("TOMOGEOM", 8);
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+    out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+
+    for (int i = 0; i < g.projection_count(); ++i) {
+        if (g.projection_shape(i) != shape) {
+            throw invalid_geometry_file("projections of different shapes");
+        }
+        auto vectors = geometry_file::to_vectors(g, i);
+        out.write(reinterpret_cast<const char*>(vectors.data()),
+                  vectors.size() * sizeof(double));
+    }
+
+    if (!out) {
+        throw invalid_geometry_file("could not write '" + path + "'");
+    }
+}
+
+/**
+ * Read the projection vectors of an ASTRA `cone_vec` geometry from a text
+ * file with 12 numbers per line (e.g. as written by `numpy.savetxt`), see
+ * `geometry_file`.
+ *
+ * \param shape the shape of the detector, columns first
+ */
+template <typename T>
+std::unique_ptr<geometry::custom<T>>
+read_astra_vectors(std::string path, math::vec<2_D, int> shape) {
+    std::ifstream in(path);
+    if (!in) {
+        throw invalid_geometry_file("could not open '" + path + "'");
+    }
+
+    auto projections = std::vector<geometry::projection<3_D, T>>();
+    double vectors[geometry_file::vector_size];
+    for (std::string line; std::getline(in, line);) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos ||
+            line[line.find_first_not_of(" \t\r")] == '#') {
+            continue;
+        }
+        std::istringstream values(line);
+        for (auto& x : vectors) {
+            if (!(values >> x)) {
+                throw invalid_geometry_file(
+                    "expected 12 numbers per line in '" + path + "'");
+            }
+        }
+        projections.push_back(geometry_file::to_projection<T>(vectors, shape));
+    }
+
+    return std::make_unique<geometry::custom<T>>(std::move(projections));
+}
+
+} // namespace tomo
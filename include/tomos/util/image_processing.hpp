@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
 #include "../image.hpp"
 #include "../projections.hpp"
 #include "../math.hpp"
@@ -30,120 +35,207 @@ image<D, T> log(image<D, T> img) {
     return result;
 }
 
+namespace detail {
+
+template <typename X>
+struct is_container : std::false_type {};
+
 template <tomo::dimension D, typename T>
-image<D, T> operator-(image<D, T> img) {
-    auto result = img;
-    for (auto& x : result.mutable_data()) {
-        x = -x;
-    }
-    return result;
-}
+struct is_container<image<D, T>> : std::true_type {};
 
 template <tomo::dimension D, typename T>
-image<D, T> operator+(const image<D, T>& lhs, const image<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    auto result = lhs;
-    int idx = 0;
-    for (auto& x : result.mutable_data()) {
-        x += rhs[idx++];
+struct is_container<projections<D, T>> : std::true_type {};
+
+template <typename X, typename = void>
+struct is_expression : std::false_type {};
+
+template <typename X>
+struct is_expression<X, std::void_t<typename X::expression_type>>
+    : std::true_type {};
+
+/** The type of an operand, without reference and const qualifiers. */
+template <typename X>
+using plain_t = std::remove_cv_t<std::remove_reference_t<X>>;
+
+/** Images, projections, and expressions of these, can be operands. */
+template <typename X>
+constexpr bool is_operand_v =
+    is_container<plain_t<X>>::value || is_expression<plain_t<X>>::value;
+
+/**
+ * Containers that are lvalues are referred to. Temporary containers are
+ * moved into the expression, and expressions (which are small) are copied.
+ */
+template <typename X>
+using operand_t =
+    std::conditional_t<std::is_lvalue_reference<X>::value &&
+                           is_container<plain_t<X>>::value,
+                       const plain_t<X>&, plain_t<X>>;
+
+/** Obtain the image or projections underlying an operand. */
+template <typename X>
+const auto& container(const X& x) {
+    if constexpr (is_container<X>::value) {
+        return x;
+    } else {
+        return x.container();
     }
-    return result;
 }
 
-template <tomo::dimension D, typename T>
-image<D, T> operator*(const image<D, T>& lhs, const image<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    auto result = lhs;
-    int idx = 0;
-    for (auto& x : result.mutable_data()) {
-        x *= rhs[idx++];
+} // namespace detail
+
+/**
+ * The element-wise combination of two operands.
+ *
+ * Element-wise arithmetic on images and projections is evaluated lazily. An
+ * arithmetic operator returns a light-weight expression that refers to its
+ * operands, and the expression is only evaluated when it is assigned to an
+ * image or projections (or used to construct one). The complete expression
+ * is then computed in a single loop that writes directly into the
+ * destination, without temporaries:
+ *
+ * ```{.cpp}
+ * p = r + beta * p; // one pass over r and p, no allocation
+ * ```
+ *
+ * Expressions refer to the images and projections that are named in them,
+ * and take ownership of temporary ones, e.g. the result of a
+ * `forward_projection`. An expression stored in an `auto` variable is
+ * therefore valid for as long as the named operands are.
+ *
+ * \tparam L, R the operand types as deduced by the operators, i.e. lvalue
+ * references for named operands
+ */
+template <typename Op, typename L, typename R>
+class binary_expression {
+  public:
+    using expression_type = binary_expression;
+    using value_type = typename detail::plain_t<L>::value_type;
+
+    binary_expression(L&& lhs, R&& rhs)
+        : lhs_(std::forward<L>(lhs)), rhs_(std::forward<R>(rhs)) {
+        assert(lhs_.size() == rhs_.size());
     }
-    return result;
+
+    value_type operator[](size_t i) const { return Op()(lhs_[i], rhs_[i]); }
+    auto size() const { return lhs_.size(); }
+    const auto& container() const { return detail::container(lhs_); }
+
+  private:
+    detail::operand_t<L> lhs_;
+    detail::operand_t<R> rhs_;
+};
+
+/** The element-wise combination of a scalar and an operand. */
+template <typename Op, typename X>
+class scalar_expression {
+  public:
+    using expression_type = scalar_expression;
+    using value_type = typename detail::plain_t<X>::value_type;
+
+    scalar_expression(value_type scalar, X&& x)
+        : scalar_(scalar), x_(std::forward<X>(x)) {}
+
+    value_type operator[](size_t i) const { return Op()(scalar_, x_[i]); }
+    auto size() const { return x_.size(); }
+    const auto& container() const { return detail::container(x_); }
+
+  private:
+    value_type scalar_;
+    detail::operand_t<X> x_;
+};
+
+/** The element-wise application of a unary operation to an operand. */
+template <typename Op, typename X>
+class unary_expression {
+  public:
+    using expression_type = unary_expression;
+    using value_type = typename detail::plain_t<X>::value_type;
+
+    unary_expression(X&& x) : x_(std::forward<X>(x)) {}
+
+    value_type operator[](size_t i) const { return Op()(x_[i]); }
+    auto size() const { return x_.size(); }
+    const auto& container() const { return detail::container(x_); }
+
+  private:
+    detail::operand_t<X> x_;
+};
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<L> &&
+                                      detail::is_operand_v<R>>>
+auto operator+(L&& lhs, R&& rhs) {
+    return binary_expression<std::plus<>, L, R>(std::forward<L>(lhs),
+                                                std::forward<R>(rhs));
 }
 
-template <tomo::dimension D, typename T>
-image<D, T> operator/(const image<D, T>& lhs, const image<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    auto result = lhs;
-    int idx = 0;
-    for (auto& x : result.mutable_data()) {
-        x /= rhs[idx++];
-    }
-    return result;
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<L> &&
+                                      detail::is_operand_v<R>>>
+auto operator-(L&& lhs, R&& rhs) {
+    return binary_expression<std::minus<>, L, R>(std::forward<L>(lhs),
+                                                 std::forward<R>(rhs));
 }
 
-template <tomo::dimension D, typename T>
-image<D, T> operator*(T lhs, const image<D, T>& rhs) {
-    auto result = rhs;
-    for (auto& x : result.mutable_data()) {
-        x *= lhs;
-    }
-    return result;
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<L> &&
+                                      detail::is_operand_v<R>>>
+auto operator*(L&& lhs, R&& rhs) {
+    return binary_expression<std::multiplies<>, L, R>(std::forward<L>(lhs),
+                                                      std::forward<R>(rhs));
 }
 
-template <tomo::dimension D, typename T>
-image<D, T>& operator+=(image<D, T>& lhs, const image<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    int idx = 0;
-    for (auto& x : lhs.mutable_data()) {
-        x += rhs[idx++];
-    }
-    return lhs;
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<L> &&
+                                      detail::is_operand_v<R>>>
+auto operator/(L&& lhs, R&& rhs) {
+    return binary_expression<std::divides<>, L, R>(std::forward<L>(lhs),
+                                                   std::forward<R>(rhs));
 }
 
-template <tomo::dimension D, typename T>
-projections<D, T> operator*(T lhs, const projections<D, T>& rhs) {
-    auto result = rhs;
-    for (auto& x : result.mutable_data()) {
-        x *= lhs;
-    }
-    return result;
+template <typename X, typename = std::enable_if_t<detail::is_operand_v<X>>>
+auto operator*(typename detail::plain_t<X>::value_type lhs, X&& rhs) {
+    return scalar_expression<std::multiplies<>, X>(lhs, std::forward<X>(rhs));
 }
 
-template <tomo::dimension D, typename T>
-projections<D, T> operator-(const projections<D, T>& lhs, const projections<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    auto result = lhs;
-    int idx = 0;
-    for (auto& x : result.mutable_data()) {
-        x -= rhs[idx++];
-    }
-    return result;
+template <typename X, typename = std::enable_if_t<detail::is_operand_v<X>>>
+auto operator*(X&& lhs, typename detail::plain_t<X>::value_type rhs) {
+    return scalar_expression<std::multiplies<>, X>(rhs, std::forward<X>(lhs));
 }
 
-template <tomo::dimension D, typename T>
-projections<D, T>& operator-=(projections<D, T>& lhs, const projections<D, T>& rhs) {
-    assert(lhs.size() == rhs.size());
-    int idx = 0;
-    for (auto& x : lhs.mutable_data()) {
-        x -= rhs[idx++];
-    }
-    return lhs;
+template <typename X, typename = std::enable_if_t<detail::is_operand_v<X>>>
+auto operator-(X&& x) {
+    return unary_expression<std::negate<>, X>(std::forward<X>(x));
 }
 
-template <tomo::dimension D, typename T>
-image<D, T> operator-(const image<D, T>& lhs, const image<D, T>& rhs) {
+template <typename C, typename X,
+          typename = std::enable_if_t<detail::is_container<C>::value &&
+                                      detail::is_operand_v<X>>>
+C& operator+=(C& lhs, const X& rhs) {
     assert(lhs.size() == rhs.size());
-    auto result = lhs;
-    int idx = 0;
-    for (auto& x : result.mutable_data()) {
-        x -= rhs[idx++];
+    auto& data = lhs.mutable_data();
+    for (uint64_t i = 0; i < data.size(); ++i) {
+        data[i] += rhs[i];
     }
-    return result;
+    return lhs;
 }
 
-template <tomo::dimension D, typename T>
-projections<D, T>& operator+=(projections<D, T>& lhs, const projections<D, T>& rhs) {
+template <typename C, typename X,
+          typename = std::enable_if_t<detail::is_container<C>::value &&
+                                      detail::is_operand_v<X>>>
+C& operator-=(C& lhs, const X& rhs) {
     assert(lhs.size() == rhs.size());
-    int idx = 0;
-    for (auto& x : lhs.mutable_data()) {
-        x += rhs[idx++];
+    auto& data = lhs.mutable_data();
+    for (uint64_t i = 0; i < data.size(); ++i) {
+        data[i] -= rhs[i];
     }
     return lhs;
 }
 
-template <tomo::dimension D, typename T>
-projections<D, T>& operator*=(projections<D, T>& lhs, T rhs) {
+template <typename C,
+          typename = std::enable_if_t<detail::is_container<C>::value>>
+C& operator*=(C& lhs, typename C::value_type rhs) {
     for (auto& x : lhs.mutable_data()) {
         x *= rhs;
     }
@@ -1,8 +1,24 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
 #include "../common.hpp"
 #include "../geometry.hpp"
+#include "../image.hpp"
 #include "../math.hpp"
+#include "../projections.hpp"
 #include "../projector.hpp"
 
 namespace tomo {
@@ -35,4 +51,244 @@ tomo::projections<D, T> row_sums(const tomo::geometry::base<D, T>& geom,
     return result;
 }
 
+/** The row sums R and column sums C of a projection matrix. */
+template <dimension D, typename T>
+struct matrix_sums {
+    tomo::projections<D, T> rows;
+    tomo::image<D, T> columns;
+};
+
+/**
+ * Compute the row and column sums of the projection matrix in a single
+ * traversal of the geometry.
+ */
+template <dimension D, typename T>
+matrix_sums<D, T> row_and_column_sums(const tomo::geometry::base<D, T>& geom,
+                                      tomo::dim::base<D, T>& kernel) {
+    auto result = matrix_sums<D, T>{projections<D, T>(geom),
+                                    image<D, T>(kernel.get_volume())};
+    for (auto[idx, line] : geom) {
+        auto r = (T)0;
+        for (auto elem : kernel(line)) {
+            r += elem.value;
+            result.columns[elem.index] += elem.value;
+        }
+        result.rows[idx] = r;
+    }
+
+    return result;
+}
+
+/**
+ * A cache for the row and column sums of projection matrices, in memory and
+ * optionally on disk.
+ *
+ * The sums are identified by a hash of the geometry parameters (the shape,
+ * detector and source of each projection), the volume, the type and mask of
+ * the kernel and the scalar type. Computing this key only visits the
+ * projections, not the lines. Repeated reconstructions with the same scanner
+ * setup thus avoid the traversals of the geometry needed for R and C, also
+ * across runs when a directory is given. The files are named after the key,
+ * and store a second, independent hash of the parameters that has to match
+ * as well for the sums to be read.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class matrix_sums_cache {
+  public:
+    /**
+     * Construct a cache.
+     *
+     * \param directory an existing directory in which the sums are stored,
+     * or empty to only cache in memory
+     */
+    explicit matrix_sums_cache(std::string directory = "")
+        : directory_(directory) {
+        if (!directory_.empty() && directory_.back() != '/') {
+            directory_ += '/';
+        }
+    }
+
+    /**
+     * Obtain the row and column sums for a geometry and kernel, computing
+     * and storing them if they are not cached yet.
+     */
+    matrix_sums<D, T> operator()(const tomo::geometry::base<D, T>& geom,
+                                 tomo::dim::base<D, T>& kernel) {
+        auto k = keys_(geom, kernel);
+        auto result = matrix_sums<D, T>{projections<D, T>(geom),
+                                        image<D, T>(kernel.get_volume())};
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            auto it = memory_.find(k);
+            if (it != memory_.end()) {
+                result.rows.mutable_data() = it->second.first;
+                result.columns.mutable_data() = it->second.second;
+                return result;
+            }
+        }
+
+        if (read_(k, result)) {
+            store_(k, result);
+            return result;
+        }
+
+        auto sums = row_and_column_sums<D, T>(geom, kernel);
+        write_(k, sums);
+        store_(k, sums);
+        return sums;
+    }
+
+    /** Compute the key identifying the sums for a geometry and kernel. */
+    static uint64_t key(const tomo::geometry::base<D, T>& geom,
+                        tomo::dim::base<D, T>& kernel) {
+        return keys_(geom, kernel).first;
+    }
+
+    /** Drop the sums cached in memory. */
+    void clear() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        memory_.clear();
+    }
+
+  private:
+    // the key, and a second independent hash of the same parameters that is
+    // stored in the files, and compared on reading to rule out collisions
+    using keys = std::pair<uint64_t, uint64_t>;
+
+    static keys keys_(const tomo::geometry::base<D, T>& geom,
+                      tomo::dim::base<D, T>& kernel) {
+        auto h = fnv_offset_;
+        auto check = check_offset_;
+        auto add = [&](const auto& value) {
+            auto bytes = reinterpret_cast<const unsigned char*>(&value);
+            for (auto i = 0u; i < sizeof(value); ++i) {
+                h = (h ^ bytes[i]) * fnv_prime_;
+                check = (check + bytes[i] + 1) * check_prime_;
+                check ^= check >> 29;
+            }
+        };
+
+        std::string kernel_type = typeid(kernel).name();
+        for (auto c : kernel_type) {
+            add(c);
+        }
+        add((uint32_t)sizeof(T));
+
+        // masked kernels have different sums, see `dim::base::set_mask`
+        auto mask = kernel.get_mask();
+        add(mask != nullptr);
+        if (mask) {
+            add(mask->count());
+            for (auto word : mask->words()) {
+                add(word);
+            }
+        }
+
+        auto v = kernel.get_volume();
+        add(v.voxels());
+        add(v.origin());
+        add(v.physical_lengths());
+
+        add(geom.parallel());
+        add(geom.projection_count());
+        for (int i = 0; i < geom.projection_count(); ++i) {
+            add(geom.projection_shape(i));
+            add(geom.detector_corner(i));
+            add(geom.source_location(i));
+            add(geom.projection_delta(i));
+        }
+
+        return {h, check};
+    }
+
+    void store_(const keys& k, const matrix_sums<D, T>& sums) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        memory_[k] = {sums.rows.data(), sums.columns.data()};
+    }
+
+    std::string path_(const keys& k) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "sums_%016llx.bin",
+                      (unsigned long long)k.first);
+        return directory_ + name;
+    }
+
+    bool read_(const keys& k, matrix_sums<D, T>& result) const {
+        if (directory_.empty()) {
+            return false;
+        }
+        std::ifstream in(path_(k), std::ios::binary);
+        if (!in) {
+            return false;
+        }
+
+        char magic[8];
+        uint64_t check = 0;
+        uint64_t rows = 0;
+        uint64_t columns = 0;
+        in.read(magic, 8);
+        in.read(reinterpret_cast<char*>(&check), sizeof(check));
+        in.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+        in.read(reinterpret_cast<char*>(&columns), sizeof(columns));
+        if (!in || std::memcmp(magic, magic_, 8) != 0 || check != k.second ||
+            rows != result.rows.size() || columns != result.columns.size()) {
+            return false;
+        }
+
+        in.read(reinterpret_cast<char*>(result.rows.mutable_data().data()),
+                rows * sizeof(T));
+        in.read(reinterpret_cast<char*>(result.columns.mutable_data().data()),
+                columns * sizeof(T));
+        return (bool)in;
+    }
+
+    void write_(const keys& k, const matrix_sums<D, T>& sums) const {
+        if (directory_.empty()) {
+            return;
+        }
+
+        // write to a temporary file first, so that concurrent jobs never
+        // read a partial file, the name is unique per process and call
+        static std::atomic<uint64_t> writes{0};
+        auto path = path_(k);
+        auto tmp = path + ".tmp." + std::to_string(::getpid()) + "." +
+                   std::to_string(writes++);
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            uint64_t rows = sums.rows.size();
+            uint64_t columns = sums.columns.size();
+            out.write(magic_, 8);
+            out.write(reinterpret_cast<const char*>(&k.second),
+                      sizeof(k.second));
+            out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+            out.write(reinterpret_cast<const char*>(&columns),
+                      sizeof(columns));
+            out.write(reinterpret_cast<const char*>(sums.rows.data().data()),
+                      rows * sizeof(T));
+            out.write(
+                reinterpret_cast<const char*>(sums.columns.data().data()),
+                columns * sizeof(T));
+            if (!out) {
+                std::remove(tmp.c_str());
+                return;
+            }
+        }
+        std::rename(tmp.c_str(), path.c_str());
+    }
+
+    static constexpr uint64_t fnv_offset_ = 14695981039346656037ull;
+    static constexpr uint64_t fnv_prime_ = 1099511628211ull;
+    static constexpr uint64_t check_offset_ = 0x9e3779b97f4a7c15ull;
+    static constexpr uint64_t check_prime_ = 0xbf58476d1ce4e5b9ull;
+    static constexpr const char* magic_ = "TOMOSUM2";
+
+    std::string directory_;
+    std::mutex mutex_;
+    std::map<keys, std::pair<std::vector<T>, std::vector<T>>> memory_;
+};
+
 } // namespace tomo
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common.hpp"
+#include "../geometry.hpp"
+#include "../image.hpp"
+#include "../mapped_image.hpp"
+#include "../projection_store.hpp"
+#include "../projections.hpp"
+#include "../volume.hpp"
+
+namespace tomo {
+
+class invalid_npy_file : public std::runtime_error {
+    using runtime_error::runtime_error;
+};
+
+/**
+ * The header of a `.npy` file, as written by `numpy.save`.
+ *
+ * Volumes and projection stacks are stored in C order with the slowest axis
+ * first, i.e. an image on a volume of (x, y, z) voxels has shape (z, y, x),
+ * and the projections for a 3D geometry have shape (projections, rows,
+ * columns). The data of a projection stack is thus laid out as angular slabs,
+ * which can be read in chunks of consecutive projections by a
+ * `projection_store`.
+ */
+struct npy_header {
+    /** The numpy type descriptor, e.g. "<f4". */
+    std::string descr;
+    bool fortran_order = false;
+    std::vector<uint64_t> shape;
+    /** The number of bytes before the data. */
+    uint64_t data_offset = 0;
+};
+
+/** The numpy type descriptor for a scalar type. */
+template <typename T>
+std::string npy_descr() {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                  "only float and double are supported");
+    return sizeof(T) == 4 ? "<f4" : "<f8";
+}
+
+/** Read the header of a `.npy` file. */
+inline npy_header read_npy_header(std::string path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[8];
+    in.read(magic, 8);
+    if (!in || std::memcmp(magic, "\x93NUMPY", 6) != 0) {
+        throw invalid_npy_file("not a .npy file: " + path);
+    }
+
+    uint64_t length = 0;
+    auto major = (unsigned char)magic[6];
+    if (major == 1) {
+        unsigned char bytes[2];
+        in.read(reinterpret_cast<char*>(bytes), 2);
+        length = bytes[0] | (bytes[1] << 8);
+    } else {
+        unsigned char bytes[4];
+        in.read(reinterpret_cast<char*>(bytes), 4);
+        length = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+                 ((uint64_t)bytes[3] << 24);
+    }
+    auto dict = std::string(length, ' ');
+    in.read(&dict[0], length);
+    if (!in) {
+        throw invalid_npy_file("truncated header: " + path);
+    }
+
+    auto result = npy_header{};
+    result.data_offset = (major == 1 ? 10 : 12) + length;
+
+    std::smatch match;
+    if (!std::regex_search(dict, match,
+                           std::regex("'descr':\\s*'([^']*)'"))) {
+        throw invalid_npy_file("missing descr: " + path);
+    }
+    result.descr = match[1];
+    result.fortran_order = std::regex_search(
+        dict, std::regex("'fortran_order':\\s*True"));
+    if (!std::regex_search(dict, match,
+                           std::regex("'shape':\\s*\\(([^)]*)\\)"))) {
+        throw invalid_npy_file("missing shape: " + path);
+    }
+    auto dims = std::stringstream(match[1]);
+    for (std::string dim; std::getline(dims, dim, ',');) {
+        if (dim.find_first_not_of(" ") != std::string::npos) {
+            result.shape.push_back(std::stoull(dim));
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Write a version 1.0 `.npy` header, padded so that the data starts at a
+ * multiple of 64 bytes.
+ *
+ * \returns the number of bytes written
+ */
+inline uint64_t write_npy_header(std::ostream& out, std::string descr,
+                                 const std::vector<uint64_t>& shape) {
+    auto dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (auto dim : shape) {
+        dict += std::to_string(dim) + ", ";
+    }
+    // a tuple of one element keeps its trailing comma
+    dict.resize(dict.size() - (shape.size() == 1 ? 1 : 2));
+    dict += "), }";
+
+    auto padding = 63 - (10 + dict.size()) % 64;
+    dict += std::string(padding, ' ') + '\n';
+
+    out.write("\x93NUMPY\x01\x00", 8);
+    unsigned char length[2] = {(unsigned char)(dict.size() & 0xff),
+                               (unsigned char)(dict.size() >> 8)};
+    out.write(reinterpret_cast<char*>(length), 2);
+    out.write(dict.data(), dict.size());
+    return 10 + dict.size();
+}
+
+namespace detail {
+
+template <dimension D>
+std::vector<uint64_t> npy_shape(math::vec<D, int> voxels) {
+    auto result = std::vector<uint64_t>(D);
+    for (int d = 0; d < D; ++d) {
+        result[D - 1 - d] = voxels[d];
+    }
+    return result;
+}
+
+// the shape of the projections of a geometry, which should all have the same
+// shape
+template <dimension D, typename T>
+std::vector<uint64_t> npy_shape(const geometry::base<D, T>& g) {
+    auto shape = g.projection_shape(0);
+    for (int i = 1; i < g.projection_count(); ++i) {
+        if (g.projection_shape(i) != shape) {
+            throw invalid_npy_file("projections of different shapes");
+        }
+    }
+    auto result = npy_shape<D - 1>(shape);
+    result.insert(result.begin(), (uint64_t)g.projection_count());
+    return result;
+}
+
+template <typename T>
+npy_header check_npy(std::string path, const std::vector<uint64_t>& shape) {
+    auto header = read_npy_header(path);
+    if (header.descr != npy_descr<T>() || header.fortran_order) {
+        throw invalid_npy_file("expected " + npy_descr<T>() +
+                               " in C order: " + path);
+    }
+    if (header.shape != shape) {
+        throw invalid_npy_file("shape mismatch: " + path);
+    }
+    return header;
+}
+
+template <typename T>
+void write_npy(std::string path, const std::vector<uint64_t>& shape,
+               const T* data, uint64_t count) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    write_npy_header(out, npy_descr<T>(), shape);
+    out.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+    if (!out) {
+        throw invalid_npy_file("could not write: " + path);
+    }
+}
+
+template <typename T>
+void read_npy(std::string path, const npy_header& header, T* data,
+              uint64_t count) {
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(header.data_offset);
+    in.read(reinterpret_cast<char*>(data), count * sizeof(T));
+    if (!in) {
+        throw invalid_npy_file("truncated data: " + path);
+    }
+}
+
+} // namespace detail
+
+/** Write an image as a `.npy` file. */
+template <dimension D, typename T>
+void write_npy(const image<D, T>& x, std::string path) {
+    detail::write_npy(path, detail::npy_shape<D>(x.get_volume().voxels()),
+                      x.data().data(), x.size());
+}
+
+/** Write projections as a `.npy` file. */
+template <dimension D, typename T>
+void write_npy(const projections<D, T>& p, std::string path) {
+    detail::write_npy(path, detail::npy_shape(p.get_geometry()),
+                      p.data().data(), p.size());
+}
+
+/** Read an image on `v` from a `.npy` file, in a single read. */
+template <dimension D, typename T>
+image<D, T> read_npy_image(const volume<D, T>& v, std::string path) {
+    auto header = detail::check_npy<T>(path, detail::npy_shape<D>(v.voxels()));
+    auto result = image<D, T>(v);
+    detail::read_npy(path, header, result.mutable_data().data(),
+                     result.size());
+    return result;
+}
+
+/** Read the projections for `g` from a `.npy` file, in a single read. */
+template <dimension D, typename T>
+projections<D, T> read_npy_projections(const geometry::base<D, T>& g,
+                                       std::string path) {
+    auto header = detail::check_npy<T>(path, detail::npy_shape(g));
+    auto result = projections<D, T>(g);
+    detail::read_npy(path, header, result.mutable_data().data(),
+                     result.size());
+    return result;
+}
+
+/**
+ * Map an image on `v` stored in a `.npy` file, without reading or copying.
+ * If the file does not exist, it is created, and can be loaded with
+ * `numpy.load(path, mmap_mode="r")`.
+ */
+template <dimension D, typename T>
+mapped_image<D, T> map_npy_image(const volume<D, T>& v, std::string path) {
+    auto shape = detail::npy_shape<D>(v.voxels());
+    auto created = !std::ifstream(path);
+    if (created) {
+        std::ofstream out(path, std::ios::binary);
+        write_npy_header(out, npy_descr<T>(), shape);
+    }
+    auto header = detail::check_npy<T>(path, shape);
+    // the mapped image only sizes files it creates itself
+    if (created &&
+        ::truncate(path.c_str(),
+                   header.data_offset + v.cells() * sizeof(T)) != 0) {
+        throw mapped_file_error("could not resize '" + path + "'");
+    }
+    return mapped_image<D, T>(v, path, true, header.data_offset);
+}
+
+/**
+ * Open the projections for `g` stored in a `.npy` file as a store, which
+ * reads them in chunks of `chunk_projections` consecutive projections.
+ */
+template <dimension D, typename T>
+std::unique_ptr<projection_store<D, T>>
+open_npy_projections(const geometry::base<D, T>& g, std::string path,
+                     int chunk_projections, int window = 2) {
+    auto header = detail::check_npy<T>(path, detail::npy_shape(g));
+    return std::make_unique<projection_store<D, T>>(
+        g, path, chunk_projections, window, header.data_offset);
+}
+
+} // namespace tomo
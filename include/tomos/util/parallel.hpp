@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../common.hpp"
+
+namespace tomo {
+
+// the DIM is only forward declared, so that low-level math can use this file
+namespace dim {
+template <dimension D, typename T>
+class base;
+} // namespace dim
+
+namespace util {
+
+/**
+ * Obtain the number of worker threads to use. A non-positive request
+ * defaults to the number of hardware threads.
+ */
+inline int thread_count(int requested = 0) {
+    if (requested > 0) {
+        return requested;
+    }
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+/**
+ * Split the range [begin, end) in contiguous chunks, and process each chunk
+ * on its own thread.
+ *
+ * \param f callable as `f(thread_index, chunk_begin, chunk_end)`
+ * \param threads the number of threads to use, see `thread_count`
+ */
+template <typename Index, typename F>
+void parallel_for(Index begin, Index end, F&& f, int threads = 0) {
+    auto n = end - begin;
+    if (n <= 0) {
+        return;
+    }
+    auto workers = (Index)std::min<Index>(thread_count(threads), n);
+    if (workers == 1) {
+        f(0, begin, end);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    for (Index t = 0; t < workers; ++t) {
+        auto chunk_begin = begin + (n * t) / workers;
+        auto chunk_end = begin + (n * (t + 1)) / workers;
+        pool.emplace_back([&f, t, chunk_begin, chunk_end]() {
+            f((int)t, chunk_begin, chunk_end);
+        });
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+/** Create a DIM for each of the worker threads. */
+template <dimension D, typename T>
+std::vector<std::unique_ptr<dim::base<D, T>>>
+clone_kernels(const dim::base<D, T>& kernel, int count) {
+    std::vector<std::unique_ptr<dim::base<D, T>>> result;
+    for (int i = 0; i < count; ++i) {
+        result.push_back(kernel.clone());
+    }
+    return result;
+}
+
+} // namespace util
+} // namespace tomo
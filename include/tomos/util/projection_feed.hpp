@@ -0,0 +1,125 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+#include "../common.hpp"
+#include "../geometry.hpp"
+#include "../projections.hpp"
+
+namespace tomo {
+namespace util {
+
+/**
+ * Projections that arrive one by one, e.g. while they are being read from
+ * disk and corrected, and that are consumed as soon as they are available.
+ *
+ * Producers write a projection into `data()`, at the offset of the
+ * projection, and then call `arrived`. A consumer obtains the arrived
+ * projections in order of arrival from `next`. Each projection is handed out
+ * once, and is not written after its arrival.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class projection_feed {
+  public:
+    explicit projection_feed(const geometry::base<D, T>& g)
+        : data_(g), arrived_(g.projection_count(), false) {}
+
+    projection_feed(const projection_feed&) = delete;
+    projection_feed& operator=(const projection_feed&) = delete;
+
+    /** The buffer that producers write the projections into. */
+    projections<D, T>& data() { return data_; }
+    const projections<D, T>& data() const { return data_; }
+
+    /** Mark projection `i` as completely written. */
+    void arrived(int i) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (arrived_[i]) {
+                return;
+            }
+            arrived_[i] = true;
+            pending_.push_back(i);
+            ++count_;
+        }
+        changed_.notify_all();
+    }
+
+    /**
+     * Signal that no more projections will arrive, e.g. because the
+     * producer failed. The error is rethrown by `next` once the arrived
+     * projections have been handed out.
+     */
+    void close(std::exception_ptr error = nullptr) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            closed_ = true;
+            error_ = error;
+        }
+        changed_.notify_all();
+    }
+
+    /**
+     * Wait for the next projection that has arrived, and has not been handed
+     * out yet.
+     *
+     * \returns the index of the projection, or -1 if every projection has
+     * been handed out, or the feed was closed
+     */
+    int next() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] {
+            return !pending_.empty() || closed_ ||
+                   count_ == (int)arrived_.size();
+        });
+        if (pending_.empty()) {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return -1;
+        }
+        auto i = pending_.front();
+        pending_.pop_front();
+        return i;
+    }
+
+    /** Wait until every projection has arrived, or the feed was closed. */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(
+            lock, [&] { return closed_ || count_ == (int)arrived_.size(); });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    /** The number of projections that have arrived. */
+    int arrived_count() const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return count_;
+    }
+
+    /** Whether every projection has arrived. */
+    bool complete() const { return arrived_count() == (int)arrived_.size(); }
+
+  private:
+    projections<D, T> data_;
+    std::vector<bool> arrived_;
+    std::deque<int> pending_;
+    int count_ = 0;
+    bool closed_ = false;
+    std::exception_ptr error_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+};
+
+} // namespace util
+} // namespace tomo
@@ -12,6 +12,7 @@ namespace fs = std::experimental::filesystem;
 
 #include "../common.hpp"
 #include "../geometries/cone.hpp"
+#include "../geometries/custom.hpp"
 #include "../geometries/dual_axis_parallel.hpp"
 #include "../geometries/helical_cone_beam.hpp"
 #include "../geometries/laminography.hpp"
@@ -20,6 +21,7 @@ namespace fs = std::experimental::filesystem;
 #include "../geometry.hpp"
 #include "../projections.hpp"
 #include "../volume.hpp"
+#include "geometry_file.hpp"
 #include "read_tiff.hpp"
 #include "reconstruction_problem.hpp"
 
@@ -269,10 +271,34 @@ read_dual_parallel_geometry(std::shared_ptr<cpptoml::table> parameters,
         v, angle_count);
 }
 
+/**
+ * Read a custom geometry from the file given by 'vectors-file', relative to
+ * the configuration. Files ending in '.txt' contain ASTRA projection vectors
+ * as text, and need a 'detector-shape'. Other files are binary geometry
+ * files, see `geometry_file`.
+ */
+template <typename T>
+std::unique_ptr<tomo::geometry::custom<T>>
+read_custom_geometry(std::shared_ptr<cpptoml::table> parameters,
+                     fs::path root_directory) {
+    auto file = parameters->get_as<std::string>("vectors-file");
+    if (!file) {
+        throw invalid_geometry_config_error(
+            "custom geometry requires a 'vectors-file'");
+    }
+    auto path = (root_directory / *file).string();
+
+    if (fs::path(*file).extension() == ".txt") {
+        auto shape = read_vec<2_D, int>(parameters, "detector-shape");
+        return read_astra_vectors<T>(path, shape);
+    }
+    return read_geometry_file<T>(path);
+}
+
 template <tomo::dimension D, typename T>
 std::unique_ptr<tomo::geometry::base<D, T>>
 read_geometry(std::string kind, std::shared_ptr<cpptoml::table> parameters,
-              tomo::volume<D, T> v, int k = -1) {
+              tomo::volume<D, T> v, int k = -1, fs::path root_directory = {}) {
     if (kind == "parallel") {
         return read_parallel_geometry<D, T>(parameters, v, k);
     } else if (kind == "dual-parallel") {
@@ -287,6 +313,8 @@ read_geometry(std::string kind, std::shared_ptr<cpptoml::table> parameters,
         return read_laminography_geometry<T>(parameters, v, k);
     } else if (kind == "tomosynthesis") {
         return read_tomosynthesis_geometry<T>(parameters, v, k);
+    } else if (kind == "custom") {
+        return read_custom_geometry<T>(parameters, root_directory);
     } else {
         throw invalid_geometry_config_error(
             "Invalid or unsupported 'type' supplied for geometry");
@@ -360,7 +388,8 @@ reconstruction_problem<D, T> read_configuration(std::string file, int k = -1) {
     auto v = read_volume<D, T>(config->get_table("volume"), k);
 
     auto kind = config->get_as<std::string>("type");
-    auto g = read_geometry<D, T>(*kind, config->get_table("parameters"), v, k);
+    auto g = read_geometry<D, T>(*kind, config->get_table("parameters"), v, k,
+                                 root_directory);
 
     assert(g->lines() > 0);
 
@@ -1,19 +1,29 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
 #include <regex>
 #include <stdexcept>
 #include <string>
 #include <limits>
+#include <vector>
 
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
 
-// #include <opencv2/opencv.hpp>
-
 #include "../common.hpp"
 #include "../image.hpp"
+#include "../math.hpp"
+#include "../projection_store.hpp"
+#include "../projections.hpp"
 #include "../utilities.hpp"
+#include "flat_field.hpp"
+#include "parallel.hpp"
+#include "projection_feed.hpp"
 
 namespace tomo {
 
@@ -21,49 +31,400 @@ class invalid_tiff_file : public std::runtime_error {
     using runtime_error::runtime_error;
 };
 
+namespace detail {
+
+/**
+ * A minimal reader for the first image of a TIFF file. Only uncompressed,
+ * single-channel images stored in strips are supported, with 8, 16 or 32 bit
+ * (un)signed integer samples, or 32 or 64 bit floating point samples. Both
+ * byte orders are supported.
+ */
+class tiff_reader {
+  public:
+    explicit tiff_reader(std::string filename) : filename_(filename) {
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        if (!in) {
+            fail_("could not open file");
+        }
+        bytes_.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(bytes_.data()), bytes_.size());
+        if (!in) {
+            fail_("could not read file");
+        }
+
+        if (bytes_.size() < 8 || !((bytes_[0] == 'I' && bytes_[1] == 'I') ||
+                                   (bytes_[0] == 'M' && bytes_[1] == 'M'))) {
+            fail_("not a TIFF file");
+        }
+        swap_ = (bytes_[0] == 'I') != little_endian_();
+        if (u16_(2) != 42) {
+            fail_("not a classic TIFF file");
+        }
+
+        auto ifd = u32_(4);
+        auto entries = u16_(ifd);
+        auto compression = 1u;
+        auto samples = 1u;
+        for (auto e = 0u; e < entries; ++e) {
+            auto entry = ifd + 2 + 12 * e;
+            switch (u16_(entry)) {
+            case 256: width_ = (int)value_(entry, 0); break;
+            case 257: height_ = (int)value_(entry, 0); break;
+            case 258: bits_ = value_(entry, 0); break;
+            case 259: compression = value_(entry, 0); break;
+            case 277: samples = value_(entry, 0); break;
+            case 278: rows_per_strip_ = value_(entry, 0); break;
+            case 339: format_ = value_(entry, 0); break;
+            case 273: strip_offsets_ = values_(entry); break;
+            case 279: strip_bytes_ = values_(entry); break;
+            case 322: fail_("tiled images are not supported");
+            default: break;
+            }
+        }
+
+        if (compression != 1) {
+            fail_("compressed images are not supported");
+        }
+        if (samples != 1) {
+            fail_("only single-channel images are supported");
+        }
+        if (strip_offsets_.empty() ||
+            strip_offsets_.size() != strip_bytes_.size()) {
+            fail_("missing strips");
+        }
+        auto valid = (format_ == 3) ? (bits_ == 32 || bits_ == 64)
+                                    : (format_ == 1 || format_ == 2) &&
+                                          (bits_ == 8 || bits_ == 16 ||
+                                           bits_ == 32);
+        if (!valid) {
+            fail_("unsupported sample format");
+        }
+    }
+
+    /** The shape of the image, width first. */
+    math::vec<2, int> shape() const { return {width_, height_}; }
+
+    /**
+     * Decode the image into `out`, which holds width * height values. The
+     * first axis (the column) runs fastest.
+     */
+    template <typename T>
+    void read(T* out) const {
+        auto pixels = (uint64_t)width_ * height_;
+        auto size = bits_ / 8;
+        uint64_t k = 0;
+        for (uint64_t s = 0; s < strip_offsets_.size() && k < pixels; ++s) {
+            auto count = std::min(strip_bytes_[s] / size, pixels - k);
+            check_(strip_offsets_[s], count * size);
+            auto at = strip_offsets_[s];
+            for (auto end = k + count; k < end; ++k, at += size) {
+                out[k] = sample_<T>(at);
+            }
+        }
+        if (k < pixels) {
+            fail_("truncated image data");
+        }
+    }
+
+  private:
+    static bool little_endian_() {
+        uint16_t x = 1;
+        return *reinterpret_cast<unsigned char*>(&x) == 1;
+    }
+
+    [[noreturn]] void fail_(std::string what) const {
+        throw invalid_tiff_file(what + ": " + filename_);
+    }
+
+    void check_(uint64_t at, uint64_t n) const {
+        if (at + n > bytes_.size()) {
+            fail_("unexpected end of file");
+        }
+    }
+
+    template <typename S>
+    S raw_(uint64_t at) const {
+        check_(at, sizeof(S));
+        unsigned char buffer[sizeof(S)];
+        std::memcpy(buffer, bytes_.data() + at, sizeof(S));
+        if (swap_) {
+            std::reverse(buffer, buffer + sizeof(S));
+        }
+        S result;
+        std::memcpy(&result, buffer, sizeof(S));
+        return result;
+    }
+
+    uint32_t u16_(uint64_t at) const { return raw_<uint16_t>(at); }
+    uint32_t u32_(uint64_t at) const { return raw_<uint32_t>(at); }
+
+    // the k-th value of a SHORT or LONG field, which is stored in the entry
+    // itself if it fits
+    uint32_t value_(uint64_t entry, uint32_t k) const {
+        auto type = u16_(entry + 2);
+        if (type != 3 && type != 4) {
+            fail_("unexpected field type");
+        }
+        auto size = (type == 3) ? 2u : 4u;
+        auto count = u32_(entry + 4);
+        auto at = (size * count <= 4) ? entry + 8 : u32_(entry + 8);
+        return (size == 2) ? u16_(at + 2 * k) : u32_(at + 4 * k);
+    }
+
+    std::vector<uint64_t> values_(uint64_t entry) const {
+        auto result = std::vector<uint64_t>(u32_(entry + 4));
+        for (uint64_t k = 0; k < result.size(); ++k) {
+            result[k] = value_(entry, k);
+        }
+        return result;
+    }
+
+    template <typename T>
+    T sample_(uint64_t at) const {
+        switch (format_ * 100 + bits_) {
+        case 108: return (T)raw_<uint8_t>(at);
+        case 116: return (T)raw_<uint16_t>(at);
+        case 132: return (T)raw_<uint32_t>(at);
+        case 208: return (T)raw_<int8_t>(at);
+        case 216: return (T)raw_<int16_t>(at);
+        case 232: return (T)raw_<int32_t>(at);
+        case 332: return (T)raw_<float>(at);
+        default: return (T)raw_<double>(at);
+        }
+    }
+
+    std::string filename_;
+    std::vector<unsigned char> bytes_;
+    bool swap_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    uint32_t bits_ = 1;
+    uint32_t format_ = 1;
+    uint32_t rows_per_strip_ = 0;
+    std::vector<uint64_t> strip_offsets_;
+    std::vector<uint64_t> strip_bytes_;
+};
+
+} // namespace detail
+
+/** Read a (single-channel, uncompressed) TIFF file into an image. */
 template <typename T = default_scalar_type>
 tomo::image<2_D, T> tiff_to_image(std::string filename) {
-//    cv::Mat image = cv::imread(filename, CV_LOAD_IMAGE_ANYDEPTH);
-//
-//    if (!image.data)
-//        throw invalid_tiff_file("Could not open or find the image: " +
-//                                filename);
-//
-//    int w = image.cols;
-//    int h = image.rows;
-//
-//    auto v = tomo::volume<D, T>({w, h});
-//    auto result = tomo::image<D, T>(v);
-//    for (int i = 0; i < w; ++i) {
-//        for (int j = 0; j < h; ++j) {
-//            result({i, j}) = (T)image.at<int32_t>(i, j);
-//        }
-//    }
-(void)filename;
+    auto reader = detail::tiff_reader(filename);
+    auto result = tomo::image<2_D, T>(tomo::volume<2_D, T>(reader.shape()));
+    reader.read(result.mutable_data().data());
+    return result;
+}
+
+namespace detail {
 
-    auto v = tomo::volume<2_D, T>({1, 1});
-    return tomo::image<2_D, T>(v);
+// read the files of a stack into `result`, and call `arrived(i)` after the
+// i-th projection has been written
+template <dimension D, typename T, typename F>
+void read_tiff_stack(const tomo::geometry::base<D, T>& g,
+                     std::string path_pattern, int projection_count,
+                     int threads,
+                     const flat_field_correction<D, T>* correction,
+                     tomo::projections<D, T>& result, F&& arrived) {
+    if (correction) {
+        correction->check(g, projection_count);
+    }
+
+    auto workers = util::thread_count(threads);
+    auto errors = std::vector<std::exception_ptr>(workers);
+    util::parallel_for(
+        0, projection_count,
+        [&](int t, int begin, int end) {
+            try {
+                for (int i = begin; i < end; ++i) {
+                    auto filename = std::regex_replace(
+                        path_pattern, std::regex("[*]"), std::to_string(i));
+                    auto reader = detail::tiff_reader(filename);
+                    if (reader.shape() != g.projection_shape(i)) {
+                        throw invalid_tiff_file(
+                            "shape does not match the geometry: " + filename);
+                    }
+                    auto pixels = result.mutable_data().data() + g.offset(i);
+                    reader.read(pixels);
+                    if (correction) {
+                        (*correction)(pixels);
+                    }
+                    arrived(i);
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        },
+        workers);
+
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
 }
 
+} // namespace detail
+
+/**
+ * Read a stack of TIFF files, where the i-th file is obtained by replacing
+ * '*' in the pattern by i. The files are read by a pool of `threads` threads
+ * (defaults to all), and decoded directly into the projections.
+ *
+ * \param correction (optional) a flat and dark-field correction, applied to
+ * each projection right after it is decoded
+ */
 template <dimension D, typename T = default_scalar_type>
 tomo::projections<D, T>
 tiff_stack_to_projections(const tomo::geometry::base<D, T>& g,
                           std::string filename_pattern, int projection_count,
-                          fs::path root_directory = {}) {
+                          fs::path root_directory = {}, int threads = 0,
+                          const flat_field_correction<D, T>* correction =
+                              nullptr) {
     // TODO implement for other D's
     static_assert(D == 3_D, "can only read 3D projection data");
 
     tomo::projections<D, T> result(g);
+    detail::read_tiff_stack(g, root_directory.string() + filename_pattern,
+                            projection_count, threads, correction, result,
+                            [](int) {});
+    return result;
+}
+
+/**
+ * Read a stack of TIFF files into a feed in the background, see
+ * `tiff_stack_to_projections`. Each projection is handed to the consumers of
+ * the feed as soon as it has been decoded and corrected, so that e.g. a
+ * reconstruction can start before the whole stack is read.
+ *
+ * The feed is closed when the stack is read, or when reading fails. The
+ * correction (if any) and the feed should outlive the returned future.
+ *
+ * \returns a future that becomes ready once the stack is read, and that
+ * rethrows any error
+ */
+template <dimension D, typename T = default_scalar_type>
+std::future<void>
+tiff_stack_to_feed(util::projection_feed<D, T>& feed,
+                   std::string filename_pattern, int projection_count,
+                   fs::path root_directory = {}, int threads = 0,
+                   const flat_field_correction<D, T>* correction = nullptr) {
+    static_assert(D == 3_D, "can only read 3D projection data");
+
+    auto path_pattern = root_directory.string() + filename_pattern;
+    return std::async(std::launch::async, [=, &feed] {
+        try {
+            detail::read_tiff_stack(feed.data().get_geometry(), path_pattern,
+                                    projection_count, threads, correction,
+                                    feed.data(),
+                                    [&](int i) { feed.arrived(i); });
+        } catch (...) {
+            feed.close(std::current_exception());
+            throw;
+        }
+        feed.close();
+    });
+}
+
+/**
+ * Read a stack of TIFF files into a projection store, one projection at a
+ * time, so that the stack does not have to fit in memory.
+ *
+ * \param correction (optional) a flat and dark-field correction, applied to
+ * each projection before it is stored
+ */
+template <dimension D, typename T = default_scalar_type>
+void tiff_stack_to_store(tomo::projection_store<D, T>& store,
+                         std::string filename_pattern, int projection_count,
+                         fs::path root_directory = {},
+                         const flat_field_correction<D, T>* correction =
+                             nullptr) {
+    static_assert(D == 3_D, "can only read 3D projection data");
+
+    if (correction) {
+        correction->check(store.get_geometry(), projection_count);
+    }
 
     for (int i = 0; i < projection_count; ++i) {
         auto filename =
             std::regex_replace(root_directory.string() + filename_pattern,
                                std::regex("[*]"), std::to_string(i));
-        auto image = tiff_to_image<T>(filename);
-        result.set_projection(i, image);
+        auto projection = tiff_to_image<T>(filename);
+        if (correction) {
+            (*correction)(projection);
+        }
+        store.set_projection(i, projection);
     }
+}
 
-    return result;
+/**
+ * Write an image as an uncompressed TIFF file with 32-bit floating point
+ * samples, in the byte order of the machine. The first axis of the image is
+ * the column.
+ */
+template <typename T = default_scalar_type>
+void write_tiff(const tomo::image<2_D, T>& x, std::string filename) {
+    auto shape = x.get_volume().voxels();
+    uint32_t width = shape[0];
+    uint32_t height = shape[1];
+    uint16_t entries = 10;
+    uint32_t data = 8 + 2 + 12 * entries + 4;
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    auto put = [&](auto value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    // SHORT values are stored in the first two bytes of the value field
+    auto entry = [&](uint16_t tag, uint16_t type, uint32_t value) {
+        put(tag);
+        put(type);
+        put((uint32_t)1);
+        if (type == 3) {
+            put((uint16_t)value);
+            put((uint16_t)0);
+        } else {
+            put(value);
+        }
+    };
+
+    uint16_t x42 = 42;
+    out.write(*reinterpret_cast<const char*>(&x42) == 42 ? "II" : "MM", 2);
+    put(x42);
+    put((uint32_t)8);
+    put(entries);
+    entry(256, 4, width);
+    entry(257, 4, height);
+    entry(258, 3, 32);
+    entry(259, 3, 1);
+    entry(262, 3, 1);
+    entry(273, 4, data);
+    entry(277, 3, 1);
+    entry(278, 4, height);
+    entry(279, 4, width * height * 4);
+    entry(339, 3, 3);
+    put((uint32_t)0);
+
+    auto values = std::vector<float>(x.data().begin(), x.data().end());
+    out.write(reinterpret_cast<const char*>(values.data()),
+              values.size() * sizeof(float));
+    if (!out) {
+        throw invalid_tiff_file("could not write: " + filename);
+    }
+}
+
+/**
+ * Write an image as a stack of TIFF files, one for each slice along the last
+ * axis. The i-th file is obtained by replacing '*' in the pattern by i.
+ */
+template <typename T = default_scalar_type>
+void write_tiff_stack(const tomo::image<3_D, T>& x,
+                      std::string filename_pattern) {
+    for (int i = 0; i < x.get_volume().voxels()[2]; ++i) {
+        write_tiff(tomo::slice(x, i, 2),
+                   std::regex_replace(filename_pattern, std::regex("[*]"),
+                                      std::to_string(i)));
+    }
 }
 
 template <typename T = default_scalar_type>
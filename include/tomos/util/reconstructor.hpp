@@ -1,10 +1,10 @@
 #pragma once
 
-#include <mutex>
 #include <vector>
 
 #include <zmq.hpp>
 
+#include "../algorithms/pipelined.hpp"
 #include "../algorithms/sirt.hpp"
 #include "../geometry.hpp"
 #include "../image.hpp"
@@ -13,6 +13,8 @@
 #include "../phantoms.hpp"
 #include "../projections.hpp"
 #include "../projector.hpp"
+#include "projection_feed.hpp"
+#include "snapshot.hpp"
 
 namespace tomo {
 namespace util {
@@ -64,6 +66,9 @@ class on_demand_reconstructor {
 /**
  * a dummy reconstructor that caches the result of a reconstruction
  * and supplies the data where necessary
+ *
+ * The intermediate images are published through a triple buffer, so that
+ * requests for slices or volumes never stall the reconstruction.
  */
 template <typename T>
 class dummy_reconstructor : public on_demand_reconstructor<T> {
@@ -72,45 +77,40 @@ class dummy_reconstructor : public on_demand_reconstructor<T> {
                         geometry::base<3_D, T>& geometry,
                         image<3_D, T>& phantom_image,
                         projections<3_D, T> projection_stack)
-        : volume_(volume), current_image_(volume), kernel_(kernel),
-          geometry_(geometry), phantom_image_(phantom_image),
+        : volume_(volume), current_image_(image<3_D, T>(volume)),
+          kernel_(kernel), geometry_(geometry), phantom_image_(phantom_image),
           projection_stack_(projection_stack) {}
 
     void reconstruct() {
-        current_image_ = phantom_image_;
+        current_image_.publish(phantom_image_);
         this->notify();
 
         auto image = tomo::reconstruction::sirt(
             volume_, geometry_, kernel_, projection_stack_, 0.5, 10,
             {[&](tomo::image<3_D, T>& iteration_result, int) {
-                {
-                    std::lock_guard<std::mutex> guard(image_mutex_);
-                    current_image_ = iteration_result;
-                }
+                current_image_.publish(iteration_result);
                 this->notify();
             }});
 
-        std::lock_guard<std::mutex> guard(image_mutex_);
-        current_image_ = image;
+        current_image_.publish(image);
     }
 
     tomo::image<2_D, T> get_slice_data(math::slice<T> s) override {
-        std::lock_guard<std::mutex> guard(image_mutex_);
-        return slice_of_image(current_image_, s);
+        return current_image_.read(
+            [&](const image<3_D, T>& x) { return slice_of_image(x, s); });
     }
 
     tomo::image<3_D, T> get_volume_data(int resolution) override {
-        std::lock_guard<std::mutex> guard(image_mutex_);
-        return downscale<3_D, T>(current_image_, math::vec3<int>{resolution});
-        ;
+        return current_image_.read([&](const image<3_D, T>& x) {
+            return downscale<3_D, T>(x, math::vec3<int>{resolution});
+        });
     }
 
   private:
     tomo::volume<3_D, T> volume_;
 
-    image<3_D, T> current_image_;
     /* Note: we will have to return the images by value. */
-    std::mutex image_mutex_; // protects current_image_
+    snapshot_buffer<image<3_D, T>> current_image_;
 
     dim::base<3_D, T>& kernel_;
     geometry::base<3_D, T>& geometry_;
@@ -118,5 +118,56 @@ class dummy_reconstructor : public on_demand_reconstructor<T> {
     projections<3_D, T> projection_stack_;
 };
 
+/**
+ * A reconstructor that starts while the projections are still arriving, see
+ * `reconstruction::pipelined_sart`. Observers are notified of a preview
+ * image every `preview_interval` arrived projections, and after each sweep.
+ */
+template <typename T>
+class pipelined_reconstructor : public on_demand_reconstructor<T> {
+  public:
+    pipelined_reconstructor(tomo::volume<3_D, T> volume,
+                            dim::base<3_D, T>& kernel,
+                            geometry::base<3_D, T>& geometry,
+                            projection_feed<3_D, T>& feed,
+                            int preview_interval = 16)
+        : volume_(volume), current_image_(image<3_D, T>(volume)),
+          kernel_(kernel), geometry_(geometry), feed_(feed),
+          preview_interval_(preview_interval) {}
+
+    void reconstruct(int iterations = 10, double beta = 0.5) {
+        auto image = tomo::reconstruction::pipelined_sart(
+            volume_, geometry_, kernel_, feed_, beta, iterations,
+            {[&](tomo::image<3_D, T>& intermediate, int) {
+                current_image_.publish(intermediate);
+                this->notify();
+            }},
+            preview_interval_);
+
+        current_image_.publish(image);
+        this->notify();
+    }
+
+    tomo::image<2_D, T> get_slice_data(math::slice<T> s) override {
+        return current_image_.read(
+            [&](const image<3_D, T>& x) { return slice_of_image(x, s); });
+    }
+
+    tomo::image<3_D, T> get_volume_data(int resolution) override {
+        return current_image_.read([&](const image<3_D, T>& x) {
+            return downscale<3_D, T>(x, math::vec3<int>{resolution});
+        });
+    }
+
+  private:
+    tomo::volume<3_D, T> volume_;
+    snapshot_buffer<image<3_D, T>> current_image_;
+
+    dim::base<3_D, T>& kernel_;
+    geometry::base<3_D, T>& geometry_;
+    projection_feed<3_D, T>& feed_;
+    int preview_interval_;
+};
+
 } // namespace util
 } // namespace tomo
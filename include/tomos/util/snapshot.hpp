@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace tomo {
+namespace util {
+
+/**
+ * A triple buffer for publishing snapshots (e.g. of an image during a
+ * reconstruction) from a single writer to readers, without the writer ever
+ * waiting for them.
+ *
+ * The writer fills the back slot, and publishes it by atomically swapping it
+ * with the middle slot. A reader swaps the middle slot with the front slot if
+ * a newer snapshot was published, and reads the front slot. The writer and
+ * the readers never access the same slot. Readers are serialized among each
+ * other, but never block the writer.
+ *
+ * \tparam V the type of a snapshot, e.g. `image<3_D, T>`
+ */
+template <typename V>
+class snapshot_buffer {
+  public:
+    /** Construct the buffer, with each slot a copy of `initial`. */
+    explicit snapshot_buffer(const V& initial)
+        : slots_{initial, initial, initial} {}
+
+    /**
+     * Obtain the slot of the writer, which is published by the next call to
+     * `publish`. Its contents are those of an older snapshot.
+     */
+    V& back() { return slots_[back_]; }
+
+    /** Publish the slot of the writer as the latest snapshot. */
+    void publish() {
+        back_ = middle_.exchange(back_ | fresh_, std::memory_order_acq_rel) &
+                index_mask_;
+    }
+
+    /** Copy `value` into the slot of the writer, and publish it. */
+    void publish(const V& value) {
+        back() = value;
+        publish();
+    }
+
+    /**
+     * Call `f` with the latest published snapshot, and return its result. The
+     * snapshot is not modified by the writer while `f` runs.
+     */
+    template <typename F>
+    auto read(F&& f) {
+        std::lock_guard<std::mutex> guard(reader_mutex_);
+        if (middle_.load(std::memory_order_relaxed) & fresh_) {
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) &
+                     index_mask_;
+        }
+        return f(static_cast<const V&>(slots_[front_]));
+    }
+
+  private:
+    static constexpr int fresh_ = 4;
+    static constexpr int index_mask_ = 3;
+
+    std::array<V, 3> slots_;
+    int back_ = 0;
+    std::atomic<int> middle_{1};
+    int front_ = 2;
+    std::mutex reader_mutex_;
+};
+
+} // namespace util
+} // namespace tomo
@@ -4,6 +4,7 @@
 
 #include "../geometry.hpp"
 #include "../image.hpp"
+#include "../multichannel.hpp"
 #include "../volume.hpp"
 
 #include <random>
@@ -58,28 +59,33 @@ truncated_svd(geometry::base<D, T>& g, dim::base<D, T>& k, volume<D, T> v,
 
     // 1) generate `rank` random vectors
     auto Omega = std::vector<image<D, T>>(r, image<D, T>(v));
-    auto AOmega = std::vector<projections<D, T>>();
+    auto AOmega = std::vector<projections<D, T>>(r, projections<D, T>(g));
 
     for (auto& img : Omega) {
         std::generate(img.begin(), img.end(), [&]() { return rng(gen); });
     }
 
     // 2) project everything in Omega to get a vector of projections
-    // corresponding to Y
-    for (auto& img : Omega) {
-        auto y = tomo::forward_projection<D, T>(mask(img), g, k);
-        auto bandf = [&](const auto& p) {
-            auto x = mask(tomo::back_projection<D, T>(p, g, k, v));
-            return tomo::forward_projection<D, T>(mask(x), g, k);
-        };
-        AOmega.push_back(bandf(bandf(y)));
-    }
+    // corresponding to Y, all vectors share a single traversal
+    auto mask_all = [&](tomo::multi_image<D, T> imgs) {
+        for (int c = 0; c < imgs.channels(); ++c) {
+            imgs.set_channel(c, mask(imgs.channel(c)));
+        }
+        return imgs;
+    };
+    auto bandf = [&](const tomo::multi_projections<D, T>& p) {
+        auto x = mask_all(tomo::back_projection<D, T>(p, g, k, v));
+        return tomo::forward_projection<D, T>(mask_all(x), g, k);
+    };
+    auto y = tomo::forward_projection<D, T>(
+        mask_all(tomo::multi_image<D, T>(Omega)), g, k);
+    auto AY = bandf(bandf(y));
 
-    // 3) Turn AOmega into a Eigen matrix Y
+    // 3) Turn the projections into a Eigen matrix Y
     auto Y = MatrixXd(g.lines(), r);
-    for (auto i = 0u; i < g.lines(); ++i) {
+    for (uint64_t i = 0; i < g.lines(); ++i) {
         for (int j = 0; j < r; ++j) {
-            Y(i, j) = AOmega[j][i];
+            Y(i, j) = AY(i, j);
         }
     }
 
@@ -87,21 +93,23 @@ truncated_svd(geometry::base<D, T>& g, dim::base<D, T>& k, volume<D, T> v,
     auto Q = HouseholderQR<decltype(Y)>(Y).householderQ() *
              MatrixXd::Identity(g.lines(), r);
 
-    for (auto i = 0u; i < g.lines(); ++i) {
+    for (uint64_t i = 0; i < g.lines(); ++i) {
         for (int j = 0; j < r; ++j) {
             AOmega[j][i] = Q(i, j);
         }
     }
 
     // 5) Compute Omega <- A^T Q
+    auto AtQ = tomo::back_projection<D, T>(
+        tomo::multi_projections<D, T>(g, AOmega), g, k, v);
     for (int i = 0; i < r; ++i) {
-        Omega[i] = tomo::back_projection(AOmega[i], g, k, v);
+        Omega[i] = AtQ.channel(i);
     }
 
     // 6) Store Omega^T as Eigen matrix B
     auto B = MatrixXd(r, v.cells());
     for (int i = 0; i < r; ++i) {
-        for (auto j = 0u; j < v.cells(); ++j) {
+        for (uint64_t j = 0; j < v.cells(); ++j) {
             B(i, j) = Omega[i][j];
         }
     }
@@ -115,11 +123,11 @@ truncated_svd(geometry::base<D, T>& g, dim::base<D, T>& k, volume<D, T> v,
     U = Q * U;
 
     for (int i = 0; i < r; ++i) {
-        for (auto j = 0u; j < g.lines(); ++j) {
+        for (uint64_t j = 0; j < g.lines(); ++j) {
             AOmega[i][j] = U(j, i);
         }
         sigma[i] = S[i];
-        for (auto j = 0u; j < v.cells(); ++j) {
+        for (uint64_t j = 0; j < v.cells(); ++j) {
             Omega[i][j] = V(j, i);
         }
     }
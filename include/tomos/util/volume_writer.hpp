@@ -0,0 +1,194 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "../common.hpp"
+#include "../image.hpp"
+#include "../utilities.hpp"
+#include "npy.hpp"
+#include "read_tiff.hpp"
+
+namespace tomo {
+namespace util {
+
+/** The file formats that a `volume_writer` can produce. */
+enum class volume_format {
+    /** A single `.npy` file, see `write_npy`. */
+    npy,
+    /** A single file with the raw voxels, the first axis runs fastest. */
+    raw,
+    /** A TIFF file for each slice along the last axis. */
+    tiff_stack,
+    /** TIFF files of the three central orthogonal slices. */
+    orthogonal_slices
+};
+
+/**
+ * Writes reconstructed volumes to disk on a background thread, so that the
+ * solver is not blocked by the disk.
+ *
+ * Writing takes a copy of the image (a snapshot), which is then written
+ * while the solver continues. At most `max_pending` snapshots are waiting to
+ * be written; beyond that, `write` blocks until a snapshot is done, which
+ * bounds the memory that is used when the disk is slower than the solver.
+ *
+ * Errors are reported by `flush`, which waits until every snapshot is
+ * written.
+ *
+ * \tparam T the scalar type to use
+ */
+template <typename T>
+class volume_writer {
+  public:
+    explicit volume_writer(int max_pending = 2)
+        : max_pending_(std::max(max_pending, 1)),
+          worker_([this] { work_(); }) {}
+
+    volume_writer(const volume_writer&) = delete;
+    volume_writer& operator=(const volume_writer&) = delete;
+
+    ~volume_writer() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            done_ = true;
+        }
+        changed_.notify_all();
+        worker_.join();
+    }
+
+    /**
+     * Write a snapshot of `x` in the background.
+     *
+     * \param path the file to write, for TIFF stacks a pattern in which '*'
+     * is replaced by the slice index, and for orthogonal slices a prefix
+     */
+    void write(const image<3_D, T>& x, std::string path,
+               volume_format format = volume_format::npy) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock,
+                      [&] { return (int)pending_.size() < max_pending_; });
+        pending_.push_back({x, path, format});
+        lock.unlock();
+        changed_.notify_all();
+    }
+
+    /**
+     * Obtain a callback for the reconstruction algorithms, that writes the
+     * image every `interval` iterations. The iteration is substituted for
+     * '{}' in the path.
+     */
+    std::function<void(image<3_D, T>&, int)>
+    every(int interval, std::string path,
+          volume_format format = volume_format::npy) {
+        return [=](image<3_D, T>& x, int iteration) {
+            if (iteration >= 0 && (iteration + 1) % interval == 0) {
+                write(x,
+                      std::regex_replace(path, std::regex("\\{\\}"),
+                                         std::to_string(iteration)),
+                      format);
+            }
+        };
+    }
+
+    /**
+     * Wait until every snapshot has been written, and rethrow the first
+     * error that occurred while writing, if any.
+     */
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return pending_.empty() && !busy_; });
+        if (error_) {
+            auto error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    /** Write an image in one of the supported formats, synchronously. */
+    static void write_now(const image<3_D, T>& x, std::string path,
+                          volume_format format) {
+        switch (format) {
+        case volume_format::npy:
+            write_npy(x, path);
+            break;
+        case volume_format::raw: {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(x.data().data()),
+                      x.size() * sizeof(T));
+            if (!out) {
+                throw std::runtime_error("could not write: " + path);
+            }
+            break;
+        }
+        case volume_format::tiff_stack:
+            write_tiff_stack(x, path);
+            break;
+        case volume_format::orthogonal_slices: {
+            auto v = x.get_volume().voxels();
+            write_tiff(tomo::slice(x, v[0] / 2, 0), path + "_yz.tif");
+            write_tiff(tomo::slice(x, v[1] / 2, 1), path + "_xz.tif");
+            write_tiff(tomo::slice(x, v[2] / 2, 2), path + "_xy.tif");
+            break;
+        }
+        }
+    }
+
+  private:
+    struct job {
+        image<3_D, T> x;
+        std::string path;
+        volume_format format;
+    };
+
+    void work_() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            changed_.wait(lock, [&] { return done_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return;
+            }
+
+            auto next = std::move(pending_.front());
+            pending_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            changed_.notify_all();
+
+            std::exception_ptr error;
+            try {
+                write_now(next.x, next.path, next.format);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            busy_ = false;
+            if (error && !error_) {
+                error_ = error;
+            }
+            changed_.notify_all();
+        }
+    }
+
+    int max_pending_;
+    std::deque<job> pending_;
+    bool busy_ = false;
+    bool done_ = false;
+    std::exception_ptr error_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread worker_;
+};
+
+} // namespace util
+} // namespace tomo
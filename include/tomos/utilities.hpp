@@ -54,7 +54,7 @@ image<D, T> downscale(const image<D, T>& f, math::vec<D, int> new_size) {
     auto voxels = f.get_volume().voxels();
     auto stride = math::vec3<T>(voxels) / math::vec3<T>(new_size);
 
-    for (auto i = 0u; i < new_volume.cells(); ++i) {
+    for (uint64_t i = 0; i < new_volume.cells(); ++i) {
         g[i] = f(math::vec3<T>(new_volume.unroll(i)) * stride);
     }
 
@@ -127,7 +127,7 @@ void ascii_plot(const image<2_D, T>& f, T max = -1) {
 template <typename T>
 void ascii_plot(const image<3_D, T>& f, int slices = 4, int axis = 0) {
     T max = (T)0;
-    for (auto k = 0u; k < f.get_volume().cells(); ++k)
+    for (uint64_t k = 0; k < f.get_volume().cells(); ++k)
         if (f[k] > max)
             max = f[k];
 
@@ -158,14 +158,14 @@ void ascii_plot_output(ImageLike& image, math::vec2<int> dimensions,
     std::reverse(chars.begin(), chars.end());
 
     T min = std::numeric_limits<T>::max();
-    for (auto k = 0u; k < image.get_volume().cells(); ++k) {
+    for (uint64_t k = 0; k < image.get_volume().cells(); ++k) {
         if (image[k] < min) {
             min = image[k];
         }
     }
 
     if (max < 0) {
-        for (auto k = 0u; k < image.get_volume().cells(); ++k) {
+        for (uint64_t k = 0; k < image.get_volume().cells(); ++k) {
             if (image[k] > max) {
                 max = image[k];
             }
@@ -60,7 +60,7 @@ class volume {
      * \returns the index of the voxel
      */
     template <typename Vector>
-    int index_by_vector(Vector xs) const {
+    index_type index_by_vector(Vector xs) const {
         return index_by_vector_(xs);
     }
 
@@ -70,7 +70,9 @@ class volume {
      * \param xs an array describing the voxel
      * \returns the index of the voxel
      */
-    int index(math::vec<D, int> xs) const { return index_by_vector_(xs); }
+    index_type index(math::vec<D, int> xs) const {
+        return index_by_vector_(xs);
+    }
 
     /**
      * Obtain the index corresponding to a voxel
@@ -81,7 +83,7 @@ class volume {
      * \returns the index of the voxel
      */
     template <typename... Ss, typename = check_dim<D, Ss...>>
-    int index(Ss... xs) const {
+    index_type index(Ss... xs) const {
         return index_(0, 1, xs...);
     }
 
@@ -115,10 +117,10 @@ class volume {
      *
      * \returns number of voxels in the volume.
      */
-    uint64_t cells() const { return math::product<D, int>(voxels_); }
+    uint64_t cells() const { return math::reduce<D>(voxels_); }
 
     /** Unroll on index, i.e. obtain the multi-index. */
-    math::vec<D, int> unroll(int idx) {
+    math::vec<D, int> unroll(index_type idx) const {
         math::vec<D, int> cell;
         for (int d = 0; d < D; ++d) {
             cell[d] = idx % voxels_[d];
@@ -153,16 +155,17 @@ class volume {
 
   private:
     template <typename S, typename... Ss>
-    int index_(int current, int offset, S x, Ss... xs) const {
+    index_type index_(index_type current, index_type offset, S x,
+                      Ss... xs) const {
         current += offset * x;
         offset *= voxels_[D - 1 - sizeof...(xs)];
         return index_(current, offset, xs...);
     }
 
     template <typename Vector>
-    inline int index_by_vector_(Vector xs) const {
-        int result = xs[0];
-        int offset = voxels_[0];
+    inline index_type index_by_vector_(Vector xs) const {
+        index_type result = xs[0];
+        index_type offset = voxels_[0];
         for (int i = 1; i < D; ++i) {
             result += offset * xs[i];
             offset *= voxels_[i];
@@ -170,7 +173,9 @@ class volume {
         return result;
     }
 
-    int index_(int current, int /* offset */) const { return current; }
+    index_type index_(index_type current, index_type /* offset */) const {
+        return current;
+    }
 
     math::vec<D, int> voxels_;
     math::vec<D, T> lengths_;
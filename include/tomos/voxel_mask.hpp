@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "image.hpp"
+#include "math.hpp"
+#include "volume.hpp"
+
+namespace tomo {
+
+namespace dim {
+template <dimension D, typename T>
+class base;
+} // namespace dim
+
+/**
+ * A mask that marks the voxels of a volume as active or inactive, e.g. the
+ * field of view of a circular trajectory, outside of which voxels are not
+ * sampled from every direction.
+ *
+ * The active voxels form a compact index space: the k-th active voxel (in
+ * order of the volume) has compact index k. Kernels with a mask skip the
+ * inactive voxels, see `dim::base::set_mask`, and images can be stored for
+ * the active voxels only, see `compact` and `expand`.
+ *
+ * The mask is stored as a bitset, with the number of active voxels before
+ * each word of 64 voxels, i.e. it takes about 2 bits per voxel.
+ *
+ * \tparam D the dimension of the volume
+ * \tparam T the scalar type to use
+ */
+template <dimension D, typename T>
+class voxel_mask {
+  public:
+    /** Construct a mask with all voxels of the volume active. */
+    voxel_mask(volume<D, T> v)
+        : voxel_mask(v, std::vector<bool>(v.cells(), true)) {}
+
+    /** Construct a mask from a flag for each voxel of the volume. */
+    voxel_mask(volume<D, T> v, const std::vector<bool>& active)
+        : v_(v), words_((v.cells() + 63) / 64), ranks_(words_.size() + 1) {
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            if (active[j]) {
+                words_[j / 64] |= (uint64_t)1 << (j % 64);
+            }
+        }
+        for (uint64_t w = 0; w < words_.size(); ++w) {
+            ranks_[w + 1] = ranks_[w] + std::bitset<64>(words_[w]).count();
+        }
+    }
+
+    /**
+     * The mask of the voxels whose centers lie inside the cylinder inscribed
+     * in the volume, around the given axis. In 2D, this is the inscribed disk.
+     */
+    static voxel_mask cylinder(volume<D, T> v, int axis = D - 1) {
+        auto voxel_size = v.physical_lengths() / math::vec<D, T>(v.voxels());
+        auto center = v.origin() + (T)0.5 * v.physical_lengths();
+
+        auto radius = std::numeric_limits<T>::max();
+        for (int d = 0; d < D; ++d) {
+            if (D == 2 || d != axis) {
+                radius = std::min(radius, (T)0.5 * v.physical_lengths()[d]);
+            }
+        }
+
+        auto active = std::vector<bool>(v.cells());
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            auto x = v.origin() +
+                     (math::vec<D, T>(v.unroll(j)) + (T)0.5) * voxel_size;
+            auto distance = (T)0;
+            for (int d = 0; d < D; ++d) {
+                if (D == 2 || d != axis) {
+                    distance += (x[d] - center[d]) * (x[d] - center[d]);
+                }
+            }
+            active[j] = distance <= radius * radius;
+        }
+
+        return voxel_mask(v, active);
+    }
+
+    /**
+     * The mask of the voxels that are hit by a line of every projection of
+     * the geometry. This requires one traversal of the geometry, and works
+     * for any trajectory.
+     */
+    static voxel_mask field_of_view(const geometry::base<D, T>& g,
+                                    dim::base<D, T>& kernel) {
+        auto v = kernel.get_volume();
+
+        // for each voxel, the number of projections that hit it, and the last
+        // projection that did
+        auto hits = std::vector<int>(v.cells(), 0);
+        auto last = std::vector<int>(v.cells(), -1);
+        for (int i = 0; i < g.projection_count(); ++i) {
+            auto stop = g.iter_proj(i + 1);
+            for (auto it = g.iter_proj(i); it != stop; ++it) {
+                auto[local_row, line] = *it;
+                (void)local_row;
+                for (auto elem : kernel(line)) {
+                    if (last[elem.index] != i) {
+                        last[elem.index] = i;
+                        hits[elem.index]++;
+                    }
+                }
+            }
+        }
+
+        auto active = std::vector<bool>(v.cells());
+        for (uint64_t j = 0; j < v.cells(); ++j) {
+            active[j] = hits[j] == g.projection_count();
+        }
+
+        return voxel_mask(v, active);
+    }
+
+    /** Whether the j-th voxel of the volume is active. */
+    bool active(uint64_t j) const {
+        return (words_[j / 64] >> (j % 64)) & (uint64_t)1;
+    }
+
+    /** The compact index of the j-th voxel, or -1 if it is inactive. */
+    int64_t compact_index(uint64_t j) const {
+        if (!active(j)) {
+            return -1;
+        }
+        auto below = words_[j / 64] & (((uint64_t)1 << (j % 64)) - 1);
+        return (int64_t)(ranks_[j / 64] + std::bitset<64>(below).count());
+    }
+
+    /** The index in the volume of the voxel with compact index k. */
+    uint64_t voxel(uint64_t k) const {
+        auto w = (uint64_t)(std::upper_bound(ranks_.begin(), ranks_.end(), k) -
+                            ranks_.begin() - 1);
+        auto word = words_[w];
+        for (auto r = ranks_[w]; r < k; ++r) {
+            word &= word - 1;
+        }
+        auto bit = 0u;
+        while (!((word >> bit) & 1)) {
+            ++bit;
+        }
+        return w * 64 + bit;
+    }
+
+    /** The number of active voxels. */
+    uint64_t count() const { return ranks_.back(); }
+
+    /** The bits of the mask, for 64 voxels per word, see `active`. */
+    const std::vector<uint64_t>& words() const { return words_; }
+
+    /** Obtain the volume. */
+    volume<D, T> get_volume() const { return v_; }
+
+    /** Store the values of the active voxels of an image. */
+    std::vector<T> compact(const image<D, T>& x) const {
+        auto result = std::vector<T>();
+        result.reserve(count());
+        for_active_([&](uint64_t j) { result.push_back(x[j]); });
+        return result;
+    }
+
+    /** Restore an image from the values of its active voxels. */
+    image<D, T> expand(const std::vector<T>& values) const {
+        auto result = image<D, T>(v_);
+        auto k = 0u;
+        for_active_([&](uint64_t j) { result[j] = values[k++]; });
+        return result;
+    }
+
+  private:
+    template <typename F>
+    void for_active_(F&& f) const {
+        for (uint64_t w = 0; w < words_.size(); ++w) {
+            for (auto word = words_[w]; word != 0; word &= word - 1) {
+                auto bit = 0u;
+                while (!((word >> bit) & 1)) {
+                    ++bit;
+                }
+                f((uint64_t)w * 64 + bit);
+            }
+        }
+    }
+
+    volume<D, T> v_;
+    std::vector<uint64_t> words_;
+    std::vector<uint64_t> ranks_;
+};
+
+} // namespace tomo
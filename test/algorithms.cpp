@@ -0,0 +1,848 @@
+#include "catch.hpp"
+#include "fixtures.hpp"
+#include "tomos/tomos.hpp"
+#include "tomos/algorithms/column_action.hpp"
+
+using T = float;
+
+namespace {
+
+template <tomo::dimension D>
+T residual_norm(const tomo::image<D, T>& x,
+                const tomo::geometry::base<D, T>& g,
+                tomo::dim::base<D, T>& k, const tomo::projections<D, T>& p) {
+    using namespace tomo::img;
+    return tomo::math::norm(p - tomo::forward_projection(x, g, k));
+}
+
+// records the statuses passed to it, and never stops
+struct recorder : tomo::reconstruction::stopping_criterion {
+    std::vector<tomo::reconstruction::iteration_status> statuses;
+
+    bool operator()(
+        const tomo::reconstruction::iteration_status& status) override {
+        statuses.push_back(status);
+        return false;
+    }
+};
+
+// the iteration after which `stop` fires for the statuses of a full run
+int firing_iteration(const recorder& run,
+                     tomo::reconstruction::stopping_criterion& stop) {
+    stop.start();
+    for (auto& status : run.statuses) {
+        if (stop(status)) {
+            return status.iteration;
+        }
+    }
+    return -1;
+}
+
+// the shared problem at a higher resolution
+struct large_problem : problem<T> {
+    large_problem() : problem<T>(16) {}
+};
+
+} // namespace
+
+TEST_CASE_METHOD(problem<T>, "Ordered subsets", "[algorithms]") {
+    using tomo::reconstruction::ordered_subsets;
+    using tomo::reconstruction::subset_ordering;
+
+    SECTION("Subsets partition the projections") {
+        for (auto ordering :
+             {subset_ordering::sequential, subset_ordering::interleaved,
+              subset_ordering::golden_angle, subset_ordering::random}) {
+            auto subsets = ordered_subsets(30, 7, ordering, 1234);
+            REQUIRE(subsets.size() == 7);
+
+            std::vector<int> seen(30, 0);
+            for (int s = 0; s < subsets.size(); ++s) {
+                for (auto i : subsets[s]) {
+                    seen[i]++;
+                }
+            }
+            CHECK(std::all_of(seen.begin(), seen.end(),
+                              [](int x) { return x == 1; }));
+
+            auto order = subsets.order(3);
+            std::sort(order.begin(), order.end());
+            for (int s = 0; s < subsets.size(); ++s) {
+                CHECK(order[s] == s);
+            }
+        }
+    }
+
+    SECTION("Random ordering is reproducible") {
+        auto a = ordered_subsets(30, 10, subset_ordering::random, 42);
+        auto b = ordered_subsets(30, 10, subset_ordering::random, 42);
+        CHECK(a.order(5) == b.order(5));
+    }
+
+    SECTION("OS-SIRT reduces the residual") {
+        auto x0 = tomo::image<3_D, T>(v);
+        auto x = tomo::reconstruction::os_sirt(
+            v, g, k, p, 4, subset_ordering::golden_angle, 1.0, 5, {}, 2);
+        auto y = tomo::reconstruction::sirt(v, g, k, p, 1.0, 5);
+
+        CHECK(residual_norm(x, g, k, p) < residual_norm(y, g, k, p));
+        CHECK(residual_norm(y, g, k, p) < residual_norm(x0, g, k, p));
+
+        // the seed of a random ordering is passed on
+        auto random = subset_ordering::random;
+        auto a = tomo::reconstruction::os_sirt(v, g, k, p, 4, random, 1.0, 1,
+                                               {}, 1, nullptr, 7);
+        auto b = tomo::reconstruction::os_sirt(
+            v, g, k, p, ordered_subsets(g.projection_count(), 4, random, 7),
+            1.0, 1);
+        CHECK(tomo::math::norm(a - b) == 0);
+
+        // with a single subset, the subset column sums are those of SIRT
+        auto z = tomo::reconstruction::os_sirt(
+            v, g, k, p, 1, subset_ordering::sequential, 1.0, 5, {}, 3);
+        CHECK(tomo::math::norm(z - y) < (T)1e-4 * tomo::math::norm(y));
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Accelerated gradient methods", "[algorithms]") {
+    SECTION("FISTA-accelerated SIRT outperforms SIRT") {
+        auto x = tomo::reconstruction::accelerated_sirt(v, g, k, p, 1.0, 10);
+        auto y = tomo::reconstruction::sirt(v, g, k, p, 1.0, 10);
+        CHECK(residual_norm(x, g, k, p) < residual_norm(y, g, k, p));
+    }
+
+    SECTION("Accelerated Landweber reduces the residual") {
+        auto x0 = tomo::image<3_D, T>(v);
+        auto x =
+            tomo::reconstruction::accelerated_landweber(v, g, k, p, 0.01, 10);
+        CHECK(residual_norm(x, g, k, p) < 0.5 * residual_norm(x0, g, k, p));
+    }
+
+    SECTION("Box constraint is respected") {
+        auto x = tomo::reconstruction::accelerated_sirt(
+            v, g, k, p, 1.0, 5, {}, true, (T)0, (T)0.5);
+        CHECK(tomo::math::min_value(x) >= (T)0);
+        CHECK(tomo::math::max_value(x) <= (T)0.5);
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Stopping criteria", "[algorithms]") {
+    using namespace tomo::reconstruction;
+
+    int performed = 0;
+    std::function<void(tomo::image<3_D, T>&, int)> count =
+        [&](tomo::image<3_D, T>&, int) { ++performed; };
+
+    // each criterion fires at the first iteration of a full run for which
+    // it holds
+    SECTION("Relative residual") {
+        auto full = recorder();
+        sirt(v, g, k, p, 1.0, 100, {}, false, (T)-1, (T)1, &full);
+        auto stop = relative_residual(0.5);
+        auto expected = firing_iteration(full, stop);
+        REQUIRE(expected > 0);
+        sirt(v, g, k, p, 1.0, 100, count, false, (T)-1, (T)1, &stop);
+        CHECK(performed == expected + 1);
+    }
+
+    SECTION("Relative update") {
+        auto full = recorder();
+        cgls(v, g, k, p, 100, {}, &full);
+        auto stop = relative_update(0.05);
+        auto expected = firing_iteration(full, stop);
+        REQUIRE(expected > 0);
+        cgls(v, g, k, p, 100, count, &stop);
+        CHECK(performed == expected + 1);
+    }
+
+    SECTION("Discrepancy principle") {
+        auto full = recorder();
+        art(v, g, k, p, 0.5, 100, {}, &full);
+        auto stop = discrepancy_principle(tomo::math::norm(p) * 0.1);
+        auto expected = firing_iteration(full, stop);
+        REQUIRE(expected > 0);
+        art(v, g, k, p, 0.5, 100, count, &stop);
+        CHECK(performed == expected + 1);
+    }
+
+    SECTION("Time budget") {
+        auto stop = time_budget(std::chrono::duration<double>(0));
+        sart(v, g, k, p, 0.5, 100, count, &stop);
+        CHECK(performed == 1);
+    }
+
+    SECTION("First of several criteria") {
+        auto full = recorder();
+        sirt(v, g, k, p, 1.0, 100, {}, false, (T)-1, (T)1, &full);
+        auto residual = relative_residual(0.5);
+        auto update = relative_update(0.01);
+        auto expected = std::min(firing_iteration(full, residual),
+                                 firing_iteration(full, update));
+        REQUIRE(expected > 0);
+        auto stop = first_of({&residual, &update});
+        sirt(v, g, k, p, 1.0, 100, count, false, (T)-1, (T)1, &stop);
+        CHECK(performed == expected + 1);
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Multiple right-hand sides", "[algorithms]") {
+    using namespace tomo::img;
+
+    tomo::image<3_D, T> h(v);
+    std::generate(h.begin(), h.end(), [n = 0]() mutable { return (T)(++n % 3); });
+    auto fs = tomo::multi_image<3_D, T>({f, h});
+
+    SECTION("Block projections agree with single projections") {
+        auto ps = tomo::forward_projection(fs, g, k);
+        REQUIRE(ps.channels() == 2);
+        for (int c = 0; c < 2; ++c) {
+            auto q = tomo::forward_projection(fs.channel(c), g, k);
+            CHECK(tomo::math::norm(q - ps.channel(c)) ==
+                  Approx(0).margin(1e-3));
+            auto b = tomo::back_projection(q, g, k, v);
+            auto bs = tomo::back_projection(ps, g, k, v);
+            CHECK(tomo::math::norm(b - bs.channel(c)) ==
+                  Approx(0).margin(1e-2));
+        }
+    }
+
+    SECTION("Block SIRT and CGLS agree with their single versions") {
+        auto ps = tomo::forward_projection(fs, g, k);
+        auto xs = tomo::reconstruction::sirt(v, g, k, ps, 1.0, 5);
+        auto ys = tomo::reconstruction::cgls(v, g, k, ps, 5);
+        for (int c = 0; c < 2; ++c) {
+            auto q = ps.channel(c);
+            auto x = tomo::reconstruction::sirt(v, g, k, q, 1.0, 5);
+            auto y = tomo::reconstruction::cgls(v, g, k, q, 5);
+            CHECK(tomo::math::norm(x - xs.channel(c)) ==
+                  Approx(0).margin(1e-3 * tomo::math::norm(x)));
+            CHECK(tomo::math::norm(y - ys.channel(c)) ==
+                  Approx(0).margin(1e-3 * tomo::math::norm(y)));
+        }
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Reconstruction plans", "[algorithms]") {
+    using namespace tomo::img;
+    using tomo::reconstruction::plan_method;
+
+    tomo::projections<3_D, T> q = (T)0.5 * p;
+
+    SECTION("Plans agree with the algorithms") {
+        auto sirt = tomo::reconstruction::plan<3_D, T>(v, g, k,
+                                                       plan_method::sirt, 1.0, 5);
+        auto x = tomo::reconstruction::sirt(v, g, k, p, 1.0, 5);
+        CHECK(tomo::math::norm(sirt.execute(p) - x) ==
+              Approx(0).margin(1e-3 * tomo::math::norm(x)));
+
+        auto cgls = tomo::reconstruction::plan<3_D, T>(v, g, k,
+                                                       plan_method::cgls, 1.0, 5);
+        auto y = tomo::reconstruction::cgls(v, g, k, p, 5);
+        CHECK(tomo::math::norm(cgls.execute(p) - y) ==
+              Approx(0).margin(1e-3 * tomo::math::norm(y)));
+
+        auto cgls2 = tomo::reconstruction::plan<3_D, T>(
+            v, g, k, plan_method::cgls2, 1.0, 5);
+        auto z = tomo::reconstruction::cgls2(v, g, k, p, 5);
+        CHECK(tomo::math::norm(cgls2.execute(p) - z) ==
+              Approx(0).margin(1e-3 * tomo::math::norm(z)));
+
+        auto cg = tomo::reconstruction::plan<3_D, T>(v, g, k, plan_method::cg,
+                                                     1.0, 5);
+        auto w = tomo::reconstruction::cg(v, g, k, p, 5);
+        CHECK(tomo::math::norm(cg.execute(p) - w) ==
+              Approx(0).margin(1e-3 * tomo::math::norm(w)));
+    }
+
+    SECTION("Plans can be executed repeatedly") {
+        for (auto method :
+             {plan_method::sirt, plan_method::landweber, plan_method::cgls,
+              plan_method::cgls2, plan_method::cg}) {
+            auto pl = tomo::reconstruction::plan<3_D, T>(v, g, k, method,
+                                                         0.01, 3);
+            auto a = tomo::image<3_D, T>(v);
+            auto b = tomo::image<3_D, T>(v);
+            pl.execute(p, a);
+            pl.execute(q, b);
+            pl.execute(p, b);
+            CHECK(tomo::math::norm(a - b) == Approx(0).margin(1e-6));
+        }
+    }
+}
+
+TEST_CASE("Parallel column action", "[algorithms]") {
+    using namespace tomo::img;
+
+    int size = 6;
+    auto v = tomo::volume<3_D, T>(size);
+    auto g = tomo::geometry::cone_beam<T>(v, size, {(T)1.5, (T)1.5},
+                                          {size, size}, (T)2.0, (T)2.0);
+    auto f = tomo::modified_shepp_logan_phantom<T>(v);
+    auto k = tomo::dim::joseph<3_D, T>(v);
+    auto p = tomo::forward_projection<3_D, T>(f, g, k);
+    auto x0 = tomo::image<3_D, T>(v);
+
+    SECTION("Cached columns agree with computed columns") {
+        auto column = tomo::column<3_D, T>(g, k);
+        auto full = tomo::column_cache<3_D, T>(g, k);
+        auto partial = tomo::column_cache<3_D, T>(g, k, 1 << 12);
+        auto norms_only = tomo::column_cache<3_D, T>(g, k, 0);
+        CHECK(full.cached_voxels() == v.cells());
+        CHECK(partial.cached_voxels() < v.cells());
+        CHECK(norms_only.cached_voxels() == 0);
+        CHECK(tomo::math::norm(norms_only.squared_norms() -
+                               full.squared_norms()) == 0);
+
+        for (auto j : {0u, 17u, 100u, 215u}) {
+            auto expected = std::vector<std::tuple<uint64_t, T>>();
+            column(v.unroll(j));
+            expected.assign(column.begin(), column.end());
+            for (auto cache : {&full, &partial, &norms_only}) {
+                auto col = (*cache)(j, column);
+                CHECK(std::vector<std::tuple<uint64_t, T>>(
+                          col.begin(), col.end()) == expected);
+            }
+        }
+    }
+
+    SECTION("Colouring partitions the voxels") {
+        auto cache = tomo::column_cache<3_D, T>(g, k);
+        auto colouring = tomo::voxel_colouring(v, g, k, &cache);
+        std::vector<int> seen(v.cells(), 0);
+        for (int c = 0; c < colouring.size(); ++c) {
+            for (auto j : colouring[c]) {
+                seen[j]++;
+            }
+        }
+        CHECK(std::all_of(seen.begin(), seen.end(),
+                          [](int x) { return x == 1; }));
+    }
+
+    SECTION("Coloured column action is independent of the threads") {
+        auto colouring = tomo::voxel_colouring(v, g, k);
+        auto x = tomo::reconstruction::column_action_coloured(
+            v, g, k, p, 0.5, 2, {}, &colouring, {}, nullptr, 1);
+        auto y = tomo::reconstruction::column_action_coloured(
+            v, g, k, p, 0.5, 2, {}, &colouring, {}, nullptr, 3);
+        CHECK(tomo::math::norm(x - y) == Approx(0));
+        auto cache = tomo::column_cache<3_D, T>(g, k);
+        auto z = tomo::reconstruction::column_action_coloured(
+            v, g, k, p, 0.5, 2, {}, nullptr, {}, nullptr, 3, &cache);
+        CHECK(tomo::math::norm(x - z) == Approx(0));
+        CHECK(residual_norm(x, g, k, p) < 0.5 * residual_norm(x0, g, k, p));
+    }
+
+    SECTION("Block-Jacobi column action reduces the residual") {
+        std::function<std::vector<uint64_t>(uint64_t)> block =
+            [](uint64_t i) { return std::vector<uint64_t>{i}; };
+        auto x = tomo::reconstruction::column_action_block(
+            v, g, k, p, block, v.cells(), 0.5, 2, {}, {}, nullptr, 3);
+        CHECK(residual_norm(x, g, k, p) < 0.5 * residual_norm(x0, g, k, p));
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Asynchronous ART", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto x0 = tomo::image<3_D, T>(v);
+
+    SECTION("Deterministic mode applies the updates serially") {
+        auto x = tomo::reconstruction::async_art(v, g, k, p, 0.5, 2, {}, 4,
+                                                 1234, true);
+
+        // serial ART, visiting the projections in the same random order
+        auto y = tomo::image<3_D, T>(v);
+        auto order = std::vector<int>(g.projection_count());
+        for (int sweep = 0; sweep < 2; ++sweep) {
+            std::iota(order.begin(), order.end(), 0);
+            std::mt19937 gen(1234 + sweep);
+            std::shuffle(order.begin(), order.end(), gen);
+            for (auto i : order) {
+                auto last = g.iter_proj(i + 1);
+                for (auto it = g.iter_proj(i); it != last; ++it) {
+                    auto[local_row, line] = *it;
+                    auto row = g.offset(i) + local_row;
+                    auto alpha = (T)0;
+                    auto w_norm = (T)0;
+                    for (auto elem : k(line)) {
+                        alpha += y[elem.index] * elem.value;
+                        w_norm += elem.value * elem.value;
+                    }
+                    if (w_norm <= tomo::math::epsilon<T>) {
+                        continue;
+                    }
+                    auto factor = (T)0.5 * ((p[row] - alpha) / w_norm);
+                    for (auto elem : k) {
+                        y[elem.index] += factor * elem.value;
+                    }
+                }
+            }
+        }
+        CHECK(tomo::math::norm(x - y) < 1e-4 * tomo::math::norm(y));
+    }
+
+    SECTION("Asynchronous updates reduce the residual") {
+        auto x = tomo::reconstruction::async_art(v, g, k, p, 0.5, 3, {}, 4);
+        CHECK(residual_norm(x, g, k, p) < 0.25 * residual_norm(x0, g, k, p));
+    }
+
+    SECTION("Changes made by the callback are kept") {
+        auto clamp = [](tomo::image<3_D, T>& x, int) {
+            for (auto& value : x) {
+                value = std::max(value, (T)0);
+            }
+        };
+        auto x = tomo::reconstruction::async_art<3_D, T>(v, g, k, p, 0.5, 3,
+                                                         clamp, 4);
+        CHECK(*std::min_element(x.begin(), x.end()) >= 0);
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Block operator and SART", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto x0 = tomo::image<3_D, T>(v);
+
+    SECTION("Block operator agrees with the full projections") {
+        auto op = tomo::block_operator<3_D, T>(g, k, 3);
+        auto first = 2;
+        auto last = 4;
+        auto offset = op.first_row(first);
+
+        auto y = std::vector<T>();
+        op.forward(first, last, f, y);
+        REQUIRE(y.size() == op.rows(first, last));
+        auto error = (T)0;
+        for (auto i = 0u; i < y.size(); ++i) {
+            error += std::abs(y[i] - p[offset + i]);
+        }
+        CHECK(error == Approx(0).margin(1e-3));
+
+        // back projecting the block equals back projecting the full
+        // projections with the other rows set to zero
+        auto q = tomo::projections<3_D, T>(g);
+        for (auto i = 0u; i < y.size(); ++i) {
+            q[offset + i] = p[offset + i];
+        }
+        auto expected = tomo::back_projection<3_D, T>(q, g, k, v);
+        op.back(0, 1, std::vector<T>(op.rows(0, 1), (T)1));
+        auto& bp = op.back(first, last, y);
+        CHECK(tomo::math::norm(bp - expected) ==
+              Approx(0).margin(1e-3 * tomo::math::norm(expected)));
+        CHECK(op.support().size() < v.cells());
+    }
+
+    SECTION("SART is independent of the threads") {
+        auto x = tomo::reconstruction::sart(v, g, k, p, 0.5, 2, {}, nullptr,
+                                            {}, 1);
+        auto y = tomo::reconstruction::sart(v, g, k, p, 0.5, 2, {}, nullptr,
+                                            {}, 3);
+        CHECK(tomo::math::norm(x - y) ==
+              Approx(0).margin(1e-4 * tomo::math::norm(x)));
+        CHECK(residual_norm(x, g, k, p) < 0.5 * residual_norm(x0, g, k, p));
+    }
+
+    SECTION("SART can be warm-started") {
+        auto x = tomo::reconstruction::sart(v, g, k, p, 0.5, 2);
+        auto y = tomo::reconstruction::sart(v, g, k, p, 0.5, 2, {}, nullptr,
+                                            std::make_optional(x));
+        CHECK(residual_norm(y, g, k, p) < residual_norm(x, g, k, p));
+    }
+
+    SECTION("SART-CG reduces the residual") {
+        auto x = tomo::reconstruction::sart_cg(v, g, k, p, 2, (T)0.5);
+        CHECK(residual_norm(x, g, k, p) < residual_norm(x0, g, k, p));
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Checkpoints", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto scratch = scratch_directory();
+    auto path = scratch.path("checkpoint.bin");
+
+    SECTION("SIRT resumes where it was interrupted") {
+        auto x = tomo::reconstruction::sirt(v, g, k, p, 1.0, 6);
+        {
+            auto checkpoints = tomo::checkpoint<T>(path, 3);
+            tomo::reconstruction::sirt(v, g, k, p, 1.0, 4, {}, false, (T)-1,
+                                       (T)1, nullptr, &checkpoints);
+            checkpoints.flush();
+        }
+        auto state = tomo::checkpoint<T>::load(path);
+        REQUIRE(state);
+        CHECK(state->iteration == 2);
+
+        auto checkpoints = tomo::checkpoint<T>(path, 3, true);
+        auto y = tomo::reconstruction::sirt(v, g, k, p, 1.0, 6, {}, false,
+                                            (T)-1, (T)1, nullptr, &checkpoints);
+        CHECK(tomo::math::norm(x - y) ==
+              Approx(0).margin(1e-5 * tomo::math::norm(x)));
+    }
+
+    SECTION("CGLS resumes where it was interrupted") {
+        auto x = tomo::reconstruction::cgls(v, g, k, p, 5);
+        {
+            auto checkpoints = tomo::checkpoint<T>(path, 1);
+            tomo::reconstruction::cgls(v, g, k, p, 2, {}, nullptr,
+                                       &checkpoints);
+        }
+        auto checkpoints = tomo::checkpoint<T>(path, 1, true);
+        auto y = tomo::reconstruction::cgls(v, g, k, p, 5, {}, nullptr,
+                                            &checkpoints);
+        CHECK(tomo::math::norm(x - y) ==
+              Approx(0).margin(1e-5 * tomo::math::norm(x)));
+
+        auto wrong = tomo::checkpoint<T>(path, 1, true);
+        CHECK_THROWS_AS(tomo::reconstruction::sirt(v, g, k, p, 1.0, 6, {},
+                                                   false, (T)-1, (T)1, nullptr,
+                                                   &wrong),
+                        tomo::invalid_checkpoint_error);
+    }
+}
+
+TEST_CASE("Progress snapshots", "[algorithms]") {
+    auto v = tomo::volume<3_D, T>(8);
+    auto snapshots = tomo::util::snapshot_buffer<tomo::image<3_D, T>>(
+        tomo::image<3_D, T>(v));
+
+    // the writer publishes constant images with increasing values, a reader
+    // should only observe complete snapshots, in order
+    int count = 200;
+    auto writer = std::thread([&] {
+        for (int k = 1; k <= count; ++k) {
+            auto& x = snapshots.back();
+            std::fill(x.begin(), x.end(), (T)k);
+            snapshots.publish();
+        }
+    });
+
+    bool complete = true;
+    bool ordered = true;
+    auto last = (T)0;
+    while (last < (T)count) {
+        snapshots.read([&](const tomo::image<3_D, T>& x) {
+            auto value = x[0];
+            for (auto j = 0u; j < v.cells(); ++j) {
+                complete = complete && x[j] == value;
+            }
+            ordered = ordered && value >= last;
+            last = value;
+        });
+    }
+    writer.join();
+
+    CHECK(complete);
+    CHECK(ordered);
+}
+
+TEST_CASE_METHOD(problem<T>, "Matrix sums", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto rs = tomo::row_sums<3_D, T>(g, k);
+    auto cs = tomo::column_sums<3_D, T>(g, k);
+
+    SECTION("Single pass") {
+        auto sums = tomo::row_and_column_sums<3_D, T>(g, k);
+        CHECK(tomo::math::norm(sums.rows - rs) == Approx(0));
+        CHECK(tomo::math::norm(sums.columns - cs) == Approx(0));
+    }
+
+    SECTION("Cache") {
+        auto other_v = tomo::volume<3_D, T>(size / 2);
+        auto other_k = tomo::dim::joseph<3_D, T>(other_v);
+        auto key = tomo::matrix_sums_cache<3_D, T>::key(g, k);
+        CHECK(key == tomo::matrix_sums_cache<3_D, T>::key(g, k));
+        CHECK(key != tomo::matrix_sums_cache<3_D, T>::key(g, other_k));
+
+        auto mask = tomo::voxel_mask<3_D, T>::cylinder(v);
+        k.set_mask(&mask);
+        CHECK(key != tomo::matrix_sums_cache<3_D, T>::key(g, k));
+        k.set_mask(nullptr);
+
+        auto scratch = scratch_directory();
+        auto directory = scratch.path();
+        {
+            auto cache = tomo::matrix_sums_cache<3_D, T>(directory);
+            auto sums = cache(g, k);
+            CHECK(tomo::math::norm(sums.rows - rs) == Approx(0));
+        }
+
+        // a new cache reads the sums stored by the previous one
+        auto cache = tomo::matrix_sums_cache<3_D, T>(directory);
+        auto sums = cache(g, k);
+        CHECK(tomo::math::norm(sums.rows - rs) == Approx(0));
+        CHECK(tomo::math::norm(sums.columns - cs) == Approx(0));
+
+        auto x = tomo::reconstruction::sirt(v, g, k, p, 1.0, 3);
+        auto y = tomo::reconstruction::sirt<3_D, T>(
+            v, g, k, p, 1.0, 3, {}, false, -1, 1, nullptr, nullptr, &cache);
+        CHECK(tomo::math::norm(x - y) == Approx(0));
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "sums_%016llx.bin",
+                      (unsigned long long)key);
+        CHECK(std::ifstream(scratch.path(name)).good());
+
+        // a file with the same key but for other parameters is not used
+        {
+            auto file = std::fstream(scratch.path(name), std::ios::binary |
+                                                             std::ios::in |
+                                                             std::ios::out);
+            uint64_t check = 0;
+            file.seekg(8);
+            file.read(reinterpret_cast<char*>(&check), sizeof(check));
+            check ^= 1;
+            file.seekp(8);
+            file.write(reinterpret_cast<const char*>(&check), sizeof(check));
+            // after the magic, the hash and the sizes, the first row sum
+            auto wrong = (T)-1;
+            file.seekp(32);
+            file.write(reinterpret_cast<const char*>(&wrong), sizeof(wrong));
+        }
+        auto fresh = tomo::matrix_sums_cache<3_D, T>(directory);
+        auto recomputed = fresh(g, k);
+        CHECK(tomo::math::norm(recomputed.rows - rs) == Approx(0));
+    }
+}
+
+TEST_CASE_METHOD(large_problem, "Region of interest", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto first = tomo::math::vec<3_D, int>(4);
+    auto voxels = tomo::math::vec<3_D, int>(6);
+    auto region = tomo::reconstruction::sub_volume(v, first, voxels);
+    auto roi_g = tomo::geometry::roi<3_D, T>(g, region);
+    auto roi_k = tomo::dim::joseph<3_D, T>(region);
+
+    // the phantom restricted to the region
+    auto crop = tomo::image<3_D, T>(region);
+    for (auto j = 0u; j < region.cells(); ++j) {
+        crop[j] = f[v.index(region.unroll(j) + first)];
+    }
+
+    SECTION("Restricted geometry") {
+        CHECK(roi_g.lines() < g.lines() / 2);
+        // the lines of the restriction are lines of the full geometry
+        auto q = tomo::forward_projection<3_D, T>(f, roi_g, k);
+        auto error = (T)0;
+        auto total = (T)0;
+        for (int i = 0; i < roi_g.projection_count(); ++i) {
+            auto rows = tomo::math::reduce<2_D>(roi_g.projection_shape(i));
+            for (auto r = 0; r < rows; ++r) {
+                auto expected = p[roi_g.global_line(i, r)];
+                error += std::abs(q[roi_g.offset(i) + r] - expected);
+                total += std::abs(expected);
+            }
+        }
+        CHECK(error < 1e-4 * total);
+    }
+
+    SECTION("Exterior is removed from the data") {
+        auto data = tomo::reconstruction::roi_data(roi_g, p, f, k);
+        auto expected = tomo::forward_projection<3_D, T>(crop, roi_g, roi_k);
+        CHECK(tomo::math::norm(data - expected) <
+              0.05 * tomo::math::norm(expected));
+    }
+
+    SECTION("Reconstruction of the region") {
+        std::function<tomo::image<3_D, T>(
+            const tomo::volume<3_D, T>&, const tomo::geometry::base<3_D, T>&,
+            const tomo::projections<3_D, T>&)>
+            solver = [](const auto& rv, const auto& rg, const auto& rp) {
+                auto rk = tomo::dim::joseph<3_D, T>(rv);
+                return tomo::reconstruction::sirt(rv, rg, rk, rp, 1.0, 20);
+            };
+        auto x = tomo::reconstruction::roi_reconstruction(g, p, region, f, k,
+                                                          solver);
+        auto x0 = tomo::image<3_D, T>(region);
+        CHECK(tomo::math::norm(x - crop) < 0.5 * tomo::math::norm(x0 - crop));
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Voxel masks", "[algorithms]") {
+    using namespace tomo::img;
+
+    SECTION("Cylindrical field of view") {
+        auto mask = tomo::voxel_mask<3_D, T>::cylinder(v, 0);
+        CHECK(mask.count() < v.cells());
+        CHECK(mask.count() > v.cells() / 2);
+
+        uint64_t k_th = 0;
+        bool consistent = true;
+        for (auto j = 0u; j < v.cells(); ++j) {
+            if (mask.active(j)) {
+                consistent = consistent &&
+                             mask.compact_index(j) == (int64_t)k_th &&
+                             mask.voxel(k_th) == j;
+                ++k_th;
+            } else {
+                consistent = consistent && mask.compact_index(j) == -1;
+            }
+        }
+        CHECK(consistent);
+        CHECK(k_th == mask.count());
+
+        auto values = mask.compact(f);
+        CHECK(values.size() == mask.count());
+        auto x = mask.expand(values);
+        bool restored = true;
+        for (auto j = 0u; j < v.cells(); ++j) {
+            restored = restored && x[j] == (mask.active(j) ? f[j] : (T)0);
+        }
+        CHECK(restored);
+    }
+
+    SECTION("Masked kernels skip inactive voxels") {
+        auto mask = tomo::voxel_mask<3_D, T>::field_of_view(g, k);
+        CHECK(mask.count() < v.cells());
+
+        k.set_mask(&mask);
+        auto q = tomo::forward_projection<3_D, T>(f, g, k);
+        auto x = tomo::reconstruction::sirt(v, g, k, q, 1.0, 3);
+        auto inactive = (T)0;
+        for (auto j = 0u; j < v.cells(); ++j) {
+            if (!mask.active(j)) {
+                inactive += std::abs(x[j]);
+            }
+        }
+        CHECK(inactive == 0);
+
+        auto y = tomo::reconstruction::column_action_cyclic(v, g, k, q, 0.5, 1);
+        inactive = (T)0;
+        for (auto j = 0u; j < v.cells(); ++j) {
+            if (!mask.active(j)) {
+                inactive += std::abs(y[j]);
+            }
+        }
+        CHECK(inactive == 0);
+        k.set_mask(nullptr);
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Memory-mapped images", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto scratch = scratch_directory();
+    auto path = scratch.path("mapped_image.bin");
+
+    {
+        auto x = tomo::mapped_image<3_D, T>(v, path);
+        x.assign(f);
+
+        auto q = tomo::projections<3_D, T>(g);
+        tomo::forward_projection(x, g, k, q);
+        CHECK(tomo::math::norm(p - q) < 1e-4 * tomo::math::norm(p));
+
+        auto b = tomo::back_projection<3_D, T>(p, g, k, v);
+        tomo::back_projection(p, g, k, x);
+        auto c = x.load();
+        CHECK(tomo::math::norm(b - c) < 1e-4 * tomo::math::norm(b));
+        x.flush();
+    }
+
+    // the voxels persist in the file
+    auto y = tomo::mapped_image<3_D, T>(v, path, false);
+    auto b = tomo::back_projection<3_D, T>(
+        tomo::forward_projection<3_D, T>(f, g, k), g, k, v);
+    CHECK(tomo::math::norm(b - y.load()) < 1e-4 * tomo::math::norm(b));
+
+    // an existing file of another size is rejected, and left as it is
+    auto w = tomo::volume<3_D, T>(size / 2);
+    auto remapped = [&] { return tomo::mapped_image<3_D, T>(w, path); };
+    CHECK_THROWS_AS(remapped(), tomo::mapped_file_error);
+    CHECK(std::ifstream(path, std::ios::ate | std::ios::binary).tellg() ==
+          (std::streamoff)(v.cells() * sizeof(T)));
+}
+
+TEST_CASE_METHOD(problem<T>, "Streamed projections", "[algorithms]") {
+    using namespace tomo::img;
+
+    auto scratch = scratch_directory();
+    auto path = scratch.path("projection_store.bin");
+    auto store = tomo::projection_store<3_D, T>(g, path, 3, 2);
+    store.assign(p);
+    CHECK(store.chunks() == 3);
+    CHECK(tomo::math::norm(store.load() - p) == 0);
+    CHECK(store.resident() <= 2);
+
+    auto other = tomo::geometry::parallel<3_D, T>(v, size / 2);
+    auto reopened = [&] {
+        return tomo::projection_store<3_D, T>(other, path, 3, 2);
+    };
+    CHECK_THROWS_AS(reopened(), tomo::projection_store_error);
+    CHECK(tomo::math::norm(store.load() - p) == 0);
+
+    SECTION("SIRT") {
+        auto x = tomo::reconstruction::sirt(v, g, k, p, 1.0, 3);
+        auto y = tomo::reconstruction::sirt(v, g, k, store, 1.0, 3);
+        CHECK(tomo::math::norm(x - y) < 1e-4 * tomo::math::norm(x));
+    }
+
+    SECTION("OS-SIRT") {
+        auto subsets = tomo::reconstruction::ordered_subsets(
+            g.projection_count(), 3,
+            tomo::reconstruction::subset_ordering::sequential);
+        auto x = tomo::reconstruction::os_sirt(v, g, k, p, subsets, 1.0, 3);
+        auto y = tomo::reconstruction::os_sirt(v, g, k, store, 1.0, 3);
+        CHECK(tomo::math::norm(x - y) < 1e-4 * tomo::math::norm(x));
+        CHECK(store.resident() <= 2);
+    }
+
+    SECTION("prefetching reads each chunk once per sweep") {
+        auto small = tomo::projection_store<3_D, T>(g, path, 1, 2);
+        auto before = small.reads();
+        tomo::reconstruction::sirt(v, g, k, small, 1.0, 2);
+        CHECK(small.reads() - before == 2 * small.chunks());
+        before = small.reads();
+        tomo::reconstruction::os_sirt(v, g, k, small, 1.0, 2);
+        CHECK(small.reads() - before == 2 * small.chunks());
+    }
+}
+
+TEST_CASE_METHOD(problem<T>, "Pipelined reconstruction", "[algorithms]") {
+    using namespace tomo::img;
+
+    // deliver the projections in reverse order, while reconstructing
+    auto feed = tomo::util::projection_feed<3_D, T>(g);
+    auto producer = std::thread([&] {
+        for (int i = g.projection_count() - 1; i >= 0; --i) {
+            for (auto r = g.offset(i); r < g.offset(i) + size * size; ++r) {
+                feed.data()[r] = p[r];
+            }
+            feed.arrived(i);
+        }
+    });
+
+    auto previews = 0;
+    auto x = tomo::reconstruction::pipelined_sart<3_D, T>(
+        v, g, k, feed, 0.5, 3,
+        [&](tomo::image<3_D, T>&, int iteration) {
+            previews += iteration < 0;
+        },
+        2, nullptr, 1);
+    producer.join();
+
+    CHECK(previews == size / 2);
+    auto y = tomo::reconstruction::sart(v, g, k, p, 0.5, 3, {}, nullptr, {}, 1);
+    CHECK(residual_norm(x, g, k, p) < 0.5 * tomo::math::norm(p));
+    CHECK(residual_norm(x, g, k, p) < 1.1 * residual_norm(y, g, k, p));
+}
+
+TEST_CASE_METHOD(problem<T>, "Background volume writer", "[algorithms]") {
+    auto scratch = scratch_directory();
+    auto writer = tomo::util::volume_writer<T>();
+    auto x = tomo::reconstruction::sirt(
+        v, g, k, p, 1.0, 4, writer.every(2, scratch.path("writer_{}.npy")));
+    writer.write(f, scratch.path("writer_*.tif"),
+                 tomo::util::volume_format::tiff_stack);
+    writer.flush();
+
+    auto y = tomo::read_npy_image(v, scratch.path("writer_3.npy"));
+    CHECK(std::equal(x.data().begin(), x.data().end(), y.data().begin()));
+    auto z = tomo::tiff_to_image<T>(scratch.path("writer_5.tif"));
+    CHECK(z({2, 3}) == f({2, 3, 5}));
+
+    writer.write(f, scratch.path("missing/x.npy"));
+    CHECK_THROWS(writer.flush());
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "tomos/tomos.hpp"
+
+/**
+ * The test problem shared by most tests: the modified Shepp-Logan phantom
+ * on a small cube, imaged with parallel beams along as many angles as there
+ * are voxels along an axis, and projected with the Joseph kernel.
+ */
+template <typename T>
+struct problem {
+    explicit problem(int size_ = 8)
+        : size(size_), v(size), g(v, size),
+          f(tomo::modified_shepp_logan_phantom<T>(v)), k(v),
+          p(tomo::forward_projection<3_D, T>(f, g, k)) {}
+
+    int size;
+    tomo::volume<3_D, T> v;
+    tomo::geometry::parallel<3_D, T> g;
+    tomo::image<3_D, T> f;
+    tomo::dim::joseph<3_D, T> k;
+    tomo::projections<3_D, T> p;
+};
+
+/**
+ * A directory for the files written by a test, created in the temporary
+ * directory. It is removed along with its files when it goes out of scope,
+ * also when the test fails.
+ */
+class scratch_directory {
+  public:
+    scratch_directory() {
+        auto base = std::getenv("TMPDIR");
+        auto pattern = std::string(base ? base : "/tmp") + "/tomos_XXXXXX";
+        if (!::mkdtemp(&pattern[0])) {
+            throw std::runtime_error("could not create '" + pattern + "'");
+        }
+        path_ = pattern;
+    }
+
+    scratch_directory(const scratch_directory&) = delete;
+    scratch_directory& operator=(const scratch_directory&) = delete;
+
+    ~scratch_directory() {
+        auto names = std::vector<std::string>();
+        if (auto dir = ::opendir(path_.c_str())) {
+            while (auto entry = ::readdir(dir)) {
+                auto name = std::string(entry->d_name);
+                if (name != "." && name != "..") {
+                    names.push_back(name);
+                }
+            }
+            ::closedir(dir);
+        }
+        for (auto& name : names) {
+            ::unlink(path(name).c_str());
+        }
+        ::rmdir(path_.c_str());
+    }
+
+    /** The path of the directory. */
+    const std::string& path() const { return path_; }
+
+    /** The path of the file `name` in the directory. */
+    std::string path(const std::string& name) const {
+        return path_ + "/" + name;
+    }
+
+  private:
+    std::string path_;
+};
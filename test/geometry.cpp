@@ -5,3 +5,48 @@ using T = float;
 
 TEST_CASE("Trajectory based geometry", "[geometry]") {
 }
+
+TEST_CASE("Geometry files", "[geometry]") {
+    using namespace tomo::img;
+
+    int k = 8;
+    auto v = tomo::volume<3_D, T>(k);
+    auto g = tomo::geometry::cone_beam<T>(v, 6, {(T)2 * k, (T)1.5 * k},
+                                          {2 * k, k}, (T)3 * k, (T)3 * k);
+    auto f = tomo::modified_shepp_logan_phantom<T>(v);
+    auto kernel = tomo::dim::joseph<3_D, T>(v);
+    auto p = tomo::forward_projection<3_D, T>(f, g, kernel);
+
+    auto compare = [&](const tomo::geometry::base<3_D, T>& h) {
+        CHECK(h.projection_count() == g.projection_count());
+        CHECK(h.lines() == g.lines());
+        auto q = tomo::forward_projection<3_D, T>(f, h, kernel);
+        CHECK(tomo::math::norm(p - q) < 1e-3 * tomo::math::norm(p));
+    };
+
+    SECTION("Binary") {
+        tomo::write_geometry_file(g, "geometry_test.geom");
+        auto h = tomo::read_geometry_file<T>("geometry_test.geom");
+        compare(*h);
+        std::remove("geometry_test.geom");
+    }
+
+    SECTION("ASTRA vectors") {
+        {
+            std::ofstream out("geometry_test.txt");
+            out << "# src, d, u, v\n";
+            for (int i = 0; i < g.projection_count(); ++i) {
+                for (auto x : tomo::geometry_file::to_vectors(g, i)) {
+                    out << std::setprecision(17) << x << ' ';
+                }
+                out << '\n';
+            }
+        }
+        auto h = tomo::read_astra_vectors<T>("geometry_test.txt", {2 * k, k});
+        compare(*h);
+        std::remove("geometry_test.txt");
+    }
+
+    CHECK_THROWS_AS(tomo::read_geometry_file<T>("geometry_test_missing.geom"),
+                    tomo::invalid_geometry_file);
+}
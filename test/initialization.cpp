@@ -1,4 +1,5 @@
 #include "catch.hpp"
+#include "fixtures.hpp"
 #include "tomos/tomos.hpp"
 
 using T = float;
@@ -31,6 +32,22 @@ TEST_CASE("We can create reconstruction volumes", "[core]") {
         CHECK(unrolled[1] == 3);
         CHECK(unrolled[2] == 5);
     }
+
+    SECTION("indexing beyond 2^31 voxels and lines") {
+        int k = 2048;
+        tomo::volume<3_D, T> v(k);
+        auto last = v.index(k - 1, k - 1, k - 1);
+        CHECK(v.cells() == (uint64_t)k * k * k);
+        CHECK((uint64_t)last == v.cells() - 1);
+        auto unrolled = v.unroll(last);
+        CHECK(unrolled[0] == k - 1);
+        CHECK(unrolled[1] == k - 1);
+        CHECK(unrolled[2] == k - 1);
+
+        auto g = tomo::geometry::parallel<3_D, T>(v, 1024);
+        CHECK(g.lines() == (uint64_t)k * k * 1024);
+        CHECK(g.offset(1023) == (tomo::index_type)k * k * 1023);
+    }
 }
 
 /* 
@@ -92,3 +109,149 @@ TEST_CASE("We can use projectors", "[core]") {
     //
 }
 */
+
+namespace {
+
+// write a single-strip TIFF file with 16 bit unsigned samples
+void write_tiff(std::string filename, int w, int h, bool big_endian) {
+    std::vector<unsigned char> bytes;
+    auto put = [&](uint32_t value, int size) {
+        for (int b = 0; b < size; ++b) {
+            auto shift = big_endian ? 8 * (size - 1 - b) : 8 * b;
+            bytes.push_back((value >> shift) & 0xff);
+        }
+    };
+    auto entry = [&](int tag, int type, uint32_t value) {
+        put(tag, 2);
+        put(type, 2);
+        put(1, 4);
+        put(value, type == 3 ? 2 : 4);
+        if (type == 3) {
+            put(0, 2);
+        }
+    };
+
+    bytes.push_back(big_endian ? 'M' : 'I');
+    bytes.push_back(big_endian ? 'M' : 'I');
+    put(42, 2);
+    put(8, 4);
+    uint32_t data = 8 + 2 + 8 * 12 + 4;
+    put(8, 2);
+    entry(256, 4, w);
+    entry(257, 4, h);
+    entry(258, 3, 16);
+    entry(259, 3, 1);
+    entry(273, 4, data);
+    entry(277, 3, 1);
+    entry(278, 4, h);
+    entry(279, 4, 2 * w * h);
+    put(0, 4);
+    for (int k = 0; k < w * h; ++k) {
+        put(k * 10, 2);
+    }
+
+    std::ofstream(filename, std::ios::binary)
+        .write(reinterpret_cast<char*>(bytes.data()), bytes.size());
+}
+
+} // namespace
+
+TEST_CASE("We can read TIFF files", "[core]") {
+    int w = 6;
+    int h = 4;
+    auto scratch = scratch_directory();
+
+    SECTION("Byte orders") {
+        for (auto big_endian : {false, true}) {
+            write_tiff(scratch.path("test.tif"), w, h, big_endian);
+            auto x = tomo::tiff_to_image<T>(scratch.path("test.tif"));
+            CHECK(x.get_volume().voxels() == tomo::math::vec<2_D, int>{w, h});
+            CHECK(x({1, 0}) == 10);
+            CHECK(x({0, 1}) == 10 * w);
+        }
+    }
+
+    SECTION("Stacks") {
+        auto v = tomo::volume<3_D, T>(w);
+        auto g = tomo::geometry::parallel<3_D, T>(v, 3);
+        h = w;
+        for (int i = 0; i < 3; ++i) {
+            write_tiff(scratch.path("test_" + std::to_string(i) + ".tif"), w,
+                       h, i == 1);
+        }
+        auto pattern = scratch.path("test_*.tif");
+        auto p = tomo::tiff_stack_to_projections<3_D, T>(g, pattern, 3, {}, 2);
+        auto feed = tomo::util::projection_feed<3_D, T>(g);
+        auto loading = tomo::tiff_stack_to_feed<3_D, T>(feed, pattern, 3);
+        auto arrivals = 0;
+        while (feed.next() >= 0) {
+            ++arrivals;
+        }
+        loading.get();
+        CHECK(arrivals == 3);
+
+        // reference frames of another shape are rejected before reading
+        auto frame = tomo::image<2_D, T>(tomo::volume<2_D, T>(w + 1), (T)1);
+        auto correction = tomo::flat_field_correction<3_D, T>({frame}, {});
+        auto corrected = [&] {
+            return tomo::tiff_stack_to_projections<3_D, T>(g, pattern, 3, {}, 2,
+                                                           &correction);
+        };
+        CHECK_THROWS_AS(corrected(), tomo::invalid_reference_frames);
+
+        for (int i = 0; i < 3; ++i) {
+            CHECK(p[g.offset(i) + w * h - 1] == 10 * (w * h - 1));
+            CHECK(feed.data()[g.offset(i) + w * h - 1] == 10 * (w * h - 1));
+        }
+
+        CHECK_THROWS_AS(tomo::tiff_to_image<T>(scratch.path("missing.tif")),
+                        tomo::invalid_tiff_file);
+    }
+}
+
+TEST_CASE("We can store images and projections as .npy files", "[core]") {
+    using namespace tomo::img;
+
+    int k = 8;
+    auto v = tomo::volume<3_D, T>(k);
+    auto g = tomo::geometry::parallel<3_D, T>(v, 4);
+    auto f = tomo::modified_shepp_logan_phantom<T>(v);
+    auto kernel = tomo::dim::joseph<3_D, T>(v);
+    auto p = tomo::forward_projection<3_D, T>(f, g, kernel);
+    auto scratch = scratch_directory();
+    auto image_path = scratch.path("image.npy");
+    auto projections_path = scratch.path("projections.npy");
+
+    tomo::write_npy(f, image_path);
+    tomo::write_npy(p, projections_path);
+
+    auto header = tomo::read_npy_header(projections_path);
+    CHECK(header.descr == "<f4");
+    CHECK(header.shape == std::vector<uint64_t>{4, (uint64_t)k, (uint64_t)k});
+    CHECK(header.data_offset % 64 == 0);
+
+    CHECK(tomo::math::norm(tomo::read_npy_image(v, image_path) - f) == 0);
+    CHECK(tomo::math::norm(tomo::read_npy_projections(g, projections_path) -
+                           p) == 0);
+
+    {
+        auto x = tomo::map_npy_image(v, image_path);
+        CHECK(std::equal(f.data().begin(), f.data().end(), x.data()));
+        x[0] = (T)1;
+    }
+    CHECK(tomo::read_npy_image(v, image_path)[0] == 1);
+
+    auto created_path = scratch.path("created.npy");
+    {
+        auto x = tomo::map_npy_image(v, created_path);
+        x[v.cells() - 1] = (T)2;
+    }
+    CHECK(tomo::read_npy_image(v, created_path)[v.cells() - 1] == 2);
+
+    auto store = tomo::open_npy_projections(g, projections_path, 2);
+    CHECK(tomo::math::norm(store->load() - p) == 0);
+
+    auto w = tomo::volume<3_D, T>(k / 2);
+    CHECK_THROWS_AS(tomo::read_npy_image(w, image_path),
+                    tomo::invalid_npy_file);
+}
@@ -22,6 +22,84 @@ TEST_CASE("Basic operations on vectors", "[math]") {
     // we assume that vector operations are handled by external library (glm)
 }
 
+TEST_CASE("Reductions", "[math]") {
+    // large enough to be reduced in parallel
+    auto v = tomo::volume<3_D, T>(128);
+    auto x = tomo::image<3_D, T>(v, (T)0.1);
+    auto y = tomo::image<3_D, T>(v, (T)2);
+
+    auto n = (double)v.cells();
+    CHECK(tomo::math::norm(x) == Approx(0.1 * std::sqrt(n)).epsilon(1e-6));
+    CHECK(tomo::math::dot(x, y) == Approx(0.2 * n).epsilon(1e-6));
+}
+
+TEST_CASE("Image and projection arithmetic", "[math]") {
+    using namespace tomo::img;
+
+    auto v = tomo::volume<2_D, T>(4);
+    auto x = tomo::image<2_D, T>(v, (T)1);
+    auto y = tomo::image<2_D, T>(v, (T)2);
+
+    SECTION("Expressions are evaluated element-wise") {
+        tomo::image<2_D, T> z = x + (T)3 * y - x / y;
+        for (auto value : z) {
+            CHECK(value == Approx(6.5));
+        }
+        z = -(z * y);
+        CHECK(z[0] == Approx(-13));
+    }
+
+    SECTION("Temporary operands are owned by the expression") {
+        auto e = x - (T)2 * tomo::image<2_D, T>(v, (T)3);
+        auto w = tomo::image<2_D, T>(v, (T)7);
+        tomo::image<2_D, T> z = e;
+        CHECK(z[0] == Approx(-5));
+        CHECK(w[0] == Approx(7));
+    }
+
+    SECTION("Destinations may appear in the expression") {
+        y = x + (T)0.5 * y;
+        y += (T)2 * x;
+        y *= (T)2;
+        CHECK(y[5] == Approx(8));
+    }
+
+    SECTION("Projections") {
+        auto g = tomo::geometry::parallel<3_D, T>(tomo::volume<3_D, T>(4), 4);
+        auto p = tomo::projections<3_D, T>(g, (T)2);
+        tomo::projections<3_D, T> q = p * (T)2 - p;
+        q -= (T)0.5 * p;
+        CHECK(q[3] == Approx(1));
+        CHECK(tomo::math::norm(p - q) == Approx(std::sqrt((T)g.lines())));
+    }
+}
+
+TEST_CASE("Flat and dark-field correction", "[math]") {
+    auto g = tomo::geometry::parallel<3_D, T>(tomo::volume<3_D, T>(4), 4);
+    auto frame = tomo::volume<2_D, T>(4);
+    auto flats = std::vector<tomo::image<2_D, T>>{
+        tomo::image<2_D, T>(frame, (T)90), tomo::image<2_D, T>(frame, (T)110)};
+    auto darks = std::vector<tomo::image<2_D, T>>{
+        tomo::image<2_D, T>(frame, (T)10)};
+    flats[0][3] = (T)10;
+    flats[1][3] = (T)10;
+    auto correct = tomo::flat_field_correction<3_D, T>(flats, darks);
+
+    // I = dark + transmission * (flat - dark)
+    auto p = tomo::projections<3_D, T>(g, (T)(10 + 0.5 * 90));
+    p[g.offset(2) + 1] = (T)0;
+    correct(p, 2);
+
+    CHECK(p[0] == Approx(-std::log(0.5)));
+    CHECK(p[g.offset(3) + 5] == Approx(-std::log(0.5)));
+    // outliers are clamped, and dead flat-field pixels are zero
+    CHECK(p[g.offset(2) + 1] == Approx(-std::log(1e-6)));
+    CHECK(p[g.offset(1) + 3] == 0);
+
+    auto wrong = tomo::image<2_D, T>(tomo::volume<2_D, T>(3));
+    CHECK_THROWS_AS(correct(wrong), tomo::invalid_reference_frames);
+}
+
 TEST_CASE("Intersection and box checking", "[math]") {
     SECTION("Line intersection") {
         using vec = tomo::math::vec2<T>;
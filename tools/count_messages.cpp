@@ -51,13 +51,13 @@ auto calculate_local_volume(bulk::rectangular_partitioning<3, 1>& partitioning,
 
 struct shared_pixel {
     int target;
-    int local_line;
-    int remote_line;
+    index_type local_line;
+    index_type remote_line;
 };
 
 struct pixel_message {
-    int local_line;
-    int remote_line;
+    index_type local_line;
+    index_type remote_line;
 };
 
 std::pair<std::vector<std::vector<pixel_message>>,
@@ -71,7 +71,7 @@ compute_contributions(bulk::world& world,
     // block_size is number of local projections
     auto block_size = ((geometry.projection_count() - 1) / p) + 1;
     auto shadows = bulk::coarray<pod_shadow>(world, p * block_size);
-    auto offsets = bulk::coarray<int>(world, p * block_size);
+    auto offsets = bulk::coarray<index_type>(world, p * block_size);
 
     // 1. send all `p` windows for all projections `i` to processor `i % p`
     for (int i = 0; i < geometry.projection_count(); ++i) {
@@ -116,11 +116,11 @@ compute_contributions(bulk::world& world,
     };
 
     auto a_targets = std::vector<std::vector<int>>(p);
-    auto a_locals = std::vector<std::vector<int>>(p);
-    auto a_remotes = std::vector<std::vector<int>>(p);
+    auto a_locals = std::vector<std::vector<index_type>>(p);
+    auto a_remotes = std::vector<std::vector<index_type>>(p);
     auto b_targets = std::vector<std::vector<int>>(p);
-    auto b_locals = std::vector<std::vector<int>>(p);
-    auto b_remotes = std::vector<std::vector<int>>(p);
+    auto b_locals = std::vector<std::vector<index_type>>(p);
+    auto b_remotes = std::vector<std::vector<index_type>>(p);
 
     for (int b = 0; b < block_size; ++b) {
         for (int i = 0; i < pixel_count; ++i) {
@@ -163,8 +163,10 @@ compute_contributions(bulk::world& world,
     pixels.clear();
     pixels.shrink_to_fit();
 
-    auto my_contributions = bulk::queue<int[], int[], int[]>(world);
-    auto my_responsibilities = bulk::queue<int[], int[], int[]>(world);
+    auto my_contributions =
+        bulk::queue<int[], index_type[], index_type[]>(world);
+    auto my_responsibilities =
+        bulk::queue<int[], index_type[], index_type[]>(world);
     for (int t = 0; t < p; ++t) {
         my_contributions(t).send(std::move(a_targets[t]),
                                  std::move(a_locals[t]),
@@ -55,13 +55,13 @@ auto calculate_local_volume(bulk::rectangular_partitioning<3, 1>& partitioning,
 
 struct shared_pixel {
     int target;
-    int local_line;
-    int remote_line;
+    index_type local_line;
+    index_type remote_line;
 };
 
 struct pixel_message {
-    int local_line;
-    int remote_line;
+    index_type local_line;
+    index_type remote_line;
 };
 
 std::pair<std::vector<std::vector<pixel_message>>,
@@ -75,7 +75,7 @@ compute_contributions(bulk::world& world,
     // block_size is number of local projections
     auto block_size = ((geometry.projection_count() - 1) / p) + 1;
     auto shadows = bulk::coarray<pod_shadow>(world, p * block_size);
-    auto offsets = bulk::coarray<int>(world, p * block_size);
+    auto offsets = bulk::coarray<index_type>(world, p * block_size);
 
     // 1. send all `p` windows for all projections `i` to processor `i % p`
     for (int i = 0; i < geometry.projection_count(); ++i) {
@@ -120,11 +120,11 @@ compute_contributions(bulk::world& world,
     };
 
     auto a_targets = std::vector<std::vector<int>>(p);
-    auto a_locals = std::vector<std::vector<int>>(p);
-    auto a_remotes = std::vector<std::vector<int>>(p);
+    auto a_locals = std::vector<std::vector<index_type>>(p);
+    auto a_remotes = std::vector<std::vector<index_type>>(p);
     auto b_targets = std::vector<std::vector<int>>(p);
-    auto b_locals = std::vector<std::vector<int>>(p);
-    auto b_remotes = std::vector<std::vector<int>>(p);
+    auto b_locals = std::vector<std::vector<index_type>>(p);
+    auto b_remotes = std::vector<std::vector<index_type>>(p);
 
     for (int b = 0; b < block_size; ++b) {
         for (int i = 0; i < pixel_count; ++i) {
@@ -167,8 +167,10 @@ compute_contributions(bulk::world& world,
     pixels.clear();
     pixels.shrink_to_fit();
 
-    auto my_contributions = bulk::queue<int[], int[], int[]>(world);
-    auto my_responsibilities = bulk::queue<int[], int[], int[]>(world);
+    auto my_contributions =
+        bulk::queue<int[], index_type[], index_type[]>(world);
+    auto my_responsibilities =
+        bulk::queue<int[], index_type[], index_type[]>(world);
     for (int t = 0; t < p; ++t) {
         my_contributions(t).send(std::move(a_targets[t]),
                                  std::move(a_locals[t]),
@@ -207,10 +209,10 @@ void communicate_contributions(
     bulk::world& world, projections<3_D, T>& projs,
     const std::vector<std::vector<pixel_message>>& contributions,
     const std::vector<std::vector<pixel_message>>& results) {
-    std::vector<int> remotes_buf;
+    std::vector<index_type> remotes_buf;
     std::vector<T> values_buf;
     int p = world.active_processors();
-    auto q = bulk::queue<int[], T[]>(world);
+    auto q = bulk::queue<index_type[], T[]>(world);
     auto share = [&, p](const auto& xs) {
         for (int t = 0; t < p; ++t) {
             remotes_buf.clear();
@@ -230,7 +232,7 @@ void communicate_contributions(
     for (auto& work : q) {
         auto& idxs = std::get<0>(work);
         auto& values = std::get<1>(work);
-        for (auto i = 0u; i < idxs.size(); ++i) {
+        for (uint64_t i = 0; i < idxs.size(); ++i) {
             projs[idxs[i]] += values[i];
         }
     }
@@ -239,7 +241,7 @@ void communicate_contributions(
     for (auto& work : q) {
         auto& idxs = std::get<0>(work);
         auto& values = std::get<1>(work);
-        for (auto i = 0u; i < idxs.size(); ++i) {
+        for (uint64_t i = 0; i < idxs.size(); ++i) {
             projs[idxs[i]] = values[i];
         }
     }
@@ -318,9 +320,9 @@ void collect_orthos(bulk::world& world, tomo::image<3_D, T> x,
             slice_yz[slice_yz.index({i, j})] = value;
         }
 
-        tomo::write_png(slice_xy, output_dir + name + "_slice_xy");
-        tomo::write_png(slice_xz, output_dir + name + "_slice_xz");
-        tomo::write_png(slice_yz, output_dir + name + "_slice_yz");
+        tomo::write_tiff(slice_xy, output_dir + name + "_slice_xy.tif");
+        tomo::write_tiff(slice_xz, output_dir + name + "_slice_xz.tif");
+        tomo::write_tiff(slice_yz, output_dir + name + "_slice_yz.tif");
     }
 }
 
@@ -329,7 +331,8 @@ void sirt(bulk::world& world,
           tomo::volume<3_D, T> global_volume,
           geometry::trajectory<3_D, T>& global_geometry,
           tomo::util::report& table, std::string name, std::string column,
-          std::string image_dir, int iters) {
+          std::string image_dir, int iters,
+          tomo::matrix_sums_cache<3_D, T>& sums_cache) {
 
     if (world.rank() == 0) {
         world.log("Running %s (%s)", name.c_str(), column.c_str());
@@ -381,12 +384,12 @@ void sirt(bulk::world& world,
     auto invert_all = [&](auto& xs) {
         std::transform(xs.begin(), xs.end(), xs.begin(), invert);
     };
-    auto r = projections<3_D, T>(gs);
-    fp(image<3_D, T>(vs, (T)1.0), gs, vs, r);
+    auto local_kernel = dimmer(vs);
+    auto sums = sums_cache(gs, local_kernel);
+    auto r = std::move(sums.rows);
     communicate_contributions(world, r, go_forth, and_back);
     invert_all(r.mutable_data());
-    auto c = image<3_D, T>(vs);
-    bp(projections<3_D, T>(gs, (T)1.0), gs, vs, c);
+    auto c = std::move(sums.columns);
     invert_all(c.mutable_data());
 
     // buffer proj stack
@@ -481,13 +484,15 @@ void sirt(bulk::world& world,
 
 void run(const std::vector<std::string>& geoms, std::string part_dir, int k,
          int iters, std::string outfile, std::string image_dir,
-         tomo::util::report& table, bool trivial, bool bisected) {
+         tomo::util::report& table, bool trivial, bool bisected,
+         std::string sums_dir) {
     bulk::mpi::environment env;
 
     auto processors = env.available_processors();
 
     env.spawn(processors, [&](auto& world) {
         auto p = world.active_processors();
+        auto sums_cache = tomo::matrix_sums_cache<3_D, T>(sums_dir);
 
         for (auto geom_file : geoms) {
             auto name = fs::path(geom_file).stem().string();
@@ -514,12 +519,12 @@ void run(const std::vector<std::string>& geoms, std::string part_dir, int k,
             if (trivial) {
                 sirt(world, block_partitioning, global_volume,
                      (tomo::geometry::trajectory<3_D, T>&)global_geometry,
-                     table, name, "trivial", image_dir, iters);
+                     table, name, "trivial", image_dir, iters, sums_cache);
             }
             if (bisected) {
                 sirt(world, *tree_partitioning, global_volume,
                      (tomo::geometry::trajectory<3_D, T>&)global_geometry,
-                     table, name, "bisected", image_dir, iters);
+                     table, name, "bisected", image_dir, iters, sums_cache);
             }
         }
 
@@ -535,7 +540,7 @@ void usage(std::string program_name) {
     std::cout << "Usage: " << program_name
               << " --geom GEOMS --part PART_DIR "
                  "--out TABLE_FILE --images IMAGE_DIR [-k SIZE] [-i "
-                 "ITERS]\n";
+                 "ITERS] [--sums SUMS_DIR]\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -560,7 +565,8 @@ int main(int argc, char* argv[]) {
 
     run(opts.args("--geom"), opts.arg("--part"), opts.arg_as_or<int>("-k", -1),
         opts.arg_as_or<int>("-i", 1), opts.arg("--out"), opts.arg("--images"),
-        table, opts.passed("--trivial"), opts.passed("--bisected"));
+        table, opts.passed("--trivial"), opts.passed("--bisected"),
+        opts.arg("--sums"));
 
     return 0;
 }